@@ -9,7 +9,7 @@ bl_info = {
     "category": "System"}
 
 # Package import
-from . import hmdl, sact, srea, swld, armature, mapa, mapu, frme, path, Nodegrid, Patching
+from . import hmdl, sact, srea, swld, armature, mapa, mapu, frme, path, Nodegrid, Patching, arrayframe
 Nodegrid = Nodegrid.Nodegrid
 parent_armature = sact.SACTSubtype.parent_armature
 import bpy, os, sys, struct, math
@@ -1,4 +1,5 @@
 import struct
+from .arrayframe import write_array
 
 def cook(writebuf, arm):
     writebuf(struct.pack('I', len(arm.bones)))
@@ -13,9 +14,7 @@ def cook(writebuf, arm):
         else:
             writebuf(struct.pack('i', -1))
 
-        writebuf(struct.pack('I', len(bone.children)))
-        for child in bone.children:
-            writebuf(struct.pack('i', arm.bones.find(child.name)))
+        write_array(writebuf, 'i', [arm.bones.find(child.name) for child in bone.children])
 
 def draw(layout, context):
     layout.prop_search(context.scene, 'hecl_arm_obj', context.scene, 'objects')
@@ -0,0 +1,23 @@
+'''
+Typed bulk-array framing for the HECL pipe protocol.
+
+Each frame is an 'IBBH' header (element count, array typecode, components per
+element, reserved) followed by the contiguous native-endian payload, so the
+C++ side consumes a whole array with a single read.
+'''
+
+import array, struct
+
+def write_array(writebuf, typecode, values, width=1):
+    if not isinstance(values, array.array) or values.typecode != typecode:
+        values = array.array(typecode, values)
+    if len(values) % width:
+        raise RuntimeError('array frame of %d values is not a multiple of width %d' % (len(values), width))
+    writebuf(struct.pack('IBBH', len(values) // width, ord(typecode), width, 0))
+    if len(values):
+        writebuf(values.tobytes())
+
+def write_bytes(writebuf, data):
+    writebuf(struct.pack('IBBH', len(data), ord('B'), 1, 0))
+    if len(data):
+        writebuf(data)
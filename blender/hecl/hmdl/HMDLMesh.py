@@ -1,100 +1,118 @@
 import bpy, bmesh, operator, struct
+from array import array
+from ..arrayframe import write_array
 
-# Function to quantize normals to 15-bit precision
-def quant_norm(n):
-    nf = n.copy()
-    for i in range(3):
-        nf[i] = int(nf[i] * 16384) / 16384.0
-    return nf.freeze()
-
-# Function to quantize lightmap UVs to 15-bit precision
-def quant_luv(n):
-    uf = n.copy()
-    for i in range(2):
-        uf[i] = int(uf[i] * 32768) / 32768.0
-    return uf.freeze()
-
-# Function to output all mesh attribute values
-def write_mesh_attrs(writebuf, bm, rna_loops, use_luv, material_slots):
-    dlay = None
-    if len(bm.verts.layers.deform):
-        dlay = bm.verts.layers.deform[0]
+# Quantize a flat float array to 1/scale steps (15-bit normals use 16384,
+# lightmap UVs use 32768)
+def quant_array(values, scale):
+    return array('f', (int(v * scale) / scale for v in values))
 
-    clays = []
-    for cl in range(len(bm.loops.layers.color)):
-        clays.append(bm.loops.layers.color[cl])
-    writebuf(struct.pack('I', len(clays)))
+# Read a per-element RNA property into a contiguous buffer
+def gather(collection, prop, typecode, width=1):
+    buf = array(typecode, bytes(array(typecode).itemsize * width * len(collection)))
+    collection.foreach_get(prop, buf)
+    return buf
 
-    luvlay = None
-    if use_luv:
-        luvlay = bm.loops.layers.uv[0]
-    ulays = []
-    for ul in range(len(bm.loops.layers.uv)):
-        ulays.append(bm.loops.layers.uv[ul])
-    writebuf(struct.pack('I', len(ulays)))
+# Function to output all mesh attribute values.
+# Each attribute (and each colour/UV layer) is sent as one array frame;
+# `mesh` is the RNA datablock `bm` was created from, so element indices agree.
+def write_mesh_attrs(writebuf, bm, mesh, use_luv, material_slots):
+    vert_count = len(mesh.vertices)
+    loop_count = len(mesh.loops)
+    face_count = len(mesh.polygons)
+
+    writebuf(struct.pack('II', len(mesh.vertex_colors), len(mesh.uv_layers)))
 
     # Verts
-    writebuf(struct.pack('I', len(bm.verts)))
-    for v in bm.verts:
-        writebuf(struct.pack('fff', v.co[0], v.co[1], v.co[2]))
-        if dlay:
-            sf = tuple(sorted(v[dlay].items()))
-            writebuf(struct.pack('I', len(sf)))
+    write_array(writebuf, 'f', gather(mesh.vertices, 'co', 'f', 3), 3)
+
+    skin_counts = array('I', bytes(4 * vert_count))
+    skin_groups = array('I')
+    skin_weights = array('f')
+    if len(bm.verts.layers.deform):
+        dlay = bm.verts.layers.deform[0]
+        for i, v in enumerate(bm.verts):
+            sf = sorted(v[dlay].items())
+            skin_counts[i] = len(sf)
             total_len = 0.0
             for ent in sf:
                 total_len += ent[1]
             for ent in sf:
-                writebuf(struct.pack('If', ent[0], ent[1] / total_len))
-        else:
-            writebuf(struct.pack('I', 0))
+                skin_groups.append(ent[0])
+                skin_weights.append(ent[1] / total_len)
+    write_array(writebuf, 'I', skin_counts)
+    write_array(writebuf, 'I', skin_groups)
+    write_array(writebuf, 'f', skin_weights)
 
     # Loops
-    loop_count = 0
-    for f in bm.faces:
-        for l in f.loops:
-            loop_count += 1
-    writebuf(struct.pack('I', loop_count))
+    loop_starts = gather(mesh.polygons, 'loop_start', 'i')
+    loop_totals = gather(mesh.polygons, 'loop_total', 'i')
+    loop_faces = array('I', bytes(4 * loop_count))
+    for f, (start, total) in enumerate(zip(loop_starts, loop_totals)):
+        loop_faces[start:start + total] = array('I', (f,)) * total
+
+    write_array(writebuf, 'f', quant_array(gather(mesh.loops, 'normal', 'f', 3), 16384), 3)
+
+    for layer in mesh.vertex_colors:
+        col = gather(layer.data, 'color', 'f', 4)
+        del col[3::4]
+        write_array(writebuf, 'f', col, 3)
+
+    for cl, layer in enumerate(mesh.uv_layers):
+        uvs = gather(layer.data, 'uv', 'f', 2)
+        if use_luv and cl == 0:
+            lightmapped = [bool(slot.material.get('retro_lightmapped', 0)) for slot in material_slots]
+            face_mats = gather(mesh.polygons, 'material_index', 'i')
+            for l, f in enumerate(loop_faces):
+                if lightmapped[face_mats[f]]:
+                    uvs[l * 2] = int(uvs[l * 2] * 32768) / 32768.0
+                    uvs[l * 2 + 1] = int(uvs[l * 2 + 1] * 32768) / 32768.0
+        write_array(writebuf, 'f', uvs, 2)
+
+    # Loop topology: vert, edge, face, next, prev, radial_next, radial_prev
+    topo = array('I', bytes(28 * loop_count))
+    topo[0::7] = array('I', gather(mesh.loops, 'vertex_index', 'i'))
+    topo[1::7] = array('I', gather(mesh.loops, 'edge_index', 'i'))
+    topo[2::7] = loop_faces
     for f in bm.faces:
         for l in f.loops:
-            if rna_loops:
-                nf = quant_norm(rna_loops[l.index].normal)
-            else:
-                nf = quant_norm(l.vert.normal)
-            writebuf(struct.pack('fff', nf[0], nf[1], nf[2]))
-            for cl in range(len(clays)):
-                col = l[clays[cl]]
-                writebuf(struct.pack('fff', col[0], col[1], col[2]))
-            for cl in range(len(ulays)):
-                if luvlay and cl == 0 and material_slots[l.face.material_index].material['retro_lightmapped']:
-                    uv = quant_luv(l[luvlay].uv)
-                else:
-                    uv = l[ulays[cl]].uv
-                writebuf(struct.pack('ff', uv[0], uv[1]))
-            writebuf(struct.pack('IIIII', l.vert.index, l.edge.index, l.face.index,
-                                 l.link_loop_next.index, l.link_loop_prev.index))
+            base = l.index * 7
+            topo[base + 3] = l.link_loop_next.index
+            topo[base + 4] = l.link_loop_prev.index
             if l.edge.is_contiguous:
-                writebuf(struct.pack('II', l.link_loop_radial_next.index, l.link_loop_radial_prev.index))
+                topo[base + 5] = l.link_loop_radial_next.index
+                topo[base + 6] = l.link_loop_radial_prev.index
             else:
-                writebuf(struct.pack('II', 0xffffffff, 0xffffffff))
+                topo[base + 5] = 0xffffffff
+                topo[base + 6] = 0xffffffff
+    write_array(writebuf, 'I', topo, 7)
 
     # Edges
-    writebuf(struct.pack('I', len(bm.edges)))
-    for e in bm.edges:
-        for v in e.verts:
-            writebuf(struct.pack('I', v.index))
-        writebuf(struct.pack('I', len(e.link_faces)))
-        for f in e.link_faces:
-            writebuf(struct.pack('I', f.index))
-        writebuf(struct.pack('b', e.is_contiguous))
+    write_array(writebuf, 'I', array('I', gather(mesh.edges, 'vertices', 'i', 2)), 2)
+
+    edge_face_counts = array('I', bytes(4 * len(bm.edges)))
+    edge_faces = array('I')
+    edge_contiguous = bytearray(len(bm.edges))
+    for i, e in enumerate(bm.edges):
+        link_faces = e.link_faces
+        edge_face_counts[i] = len(link_faces)
+        edge_faces.extend(f.index for f in link_faces)
+        edge_contiguous[i] = e.is_contiguous
+    write_array(writebuf, 'I', edge_face_counts)
+    write_array(writebuf, 'I', edge_faces)
+    write_array(writebuf, 'B', edge_contiguous)
 
     # Faces
-    writebuf(struct.pack('I', len(bm.faces)))
+    write_array(writebuf, 'f', gather(mesh.polygons, 'normal', 'f', 3), 3)
+
+    centroids = array('f')
     for f in bm.faces:
-        norm = f.normal
-        writebuf(struct.pack('fff', norm[0], norm[1], norm[2]))
-        centroid = f.calc_center_bounds()
-        writebuf(struct.pack('fff', centroid[0], centroid[1], centroid[2]))
-        writebuf(struct.pack('I', f.material_index))
-        for l in f.loops:
-            writebuf(struct.pack('I', l.index))
+        centroids.extend(f.calc_center_bounds())
+    write_array(writebuf, 'f', centroids, 3)
 
+    write_array(writebuf, 'I', array('I', gather(mesh.polygons, 'material_index', 'i')))
+
+    face_loops = array('I', bytes(12 * face_count))
+    for i in range(3):
+        face_loops[i::3] = array('I', (start + i for start in loop_starts))
+    write_array(writebuf, 'I', face_loops, 3)
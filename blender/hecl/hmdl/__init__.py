@@ -1,5 +1,6 @@
-import struct, bpy, bmesh
+import struct, bpy, bmesh, array
 from . import HMDLShader, HMDLMesh
+from ..arrayframe import write_array
 
 BLEND_TYPES = {
     'HECLAdditiveOutput': 2,
@@ -54,7 +55,6 @@ def cook(writebuf, mesh_obj, use_luv=False):
     bpy.context.scene.update_tag()
     bpy.ops.object.mode_set(mode='OBJECT')
     copy_mesh.calc_normals_split()
-    rna_loops = copy_mesh.loops
 
     # Send scene matrix
     wmtx = mesh_obj.matrix_world
@@ -98,7 +98,7 @@ def cook(writebuf, mesh_obj, use_luv=False):
             write_out_material(writebuf, mat, mesh_obj)
 
     # Output attribute lists
-    HMDLMesh.write_mesh_attrs(writebuf, bm_master, rna_loops, use_luv, mesh_obj.material_slots)
+    HMDLMesh.write_mesh_attrs(writebuf, bm_master, copy_mesh, use_luv, mesh_obj.material_slots)
 
     # Vertex groups
     writebuf(struct.pack('I', len(mesh_obj.vertex_groups)))
@@ -223,10 +223,10 @@ def cookcol(writebuf, mesh_obj):
                  screwAttackWallJump))
 
     # Send verts
-    writebuf(struct.pack('I', len(copy_mesh.vertices)))
+    xf_verts = array.array('f')
     for v in copy_mesh.vertices:
-        xfVert = wmtx @ v.co
-        writebuf(struct.pack('fff', xfVert[0], xfVert[1], xfVert[2]))
+        xf_verts.extend(wmtx @ v.co)
+    write_array(writebuf, 'f', xf_verts, 3)
 
     # Send edges
     writebuf(struct.pack('I', len(copy_mesh.edges)))
@@ -1,5 +1,6 @@
-import bpy, struct, bmesh, operator
+import bpy, struct, bmesh, operator, array
 from mathutils import Vector
+from .arrayframe import write_array
 
 # Function to quantize normals to 15-bit precision
 def quant_norm(n):
@@ -132,9 +133,10 @@ class VertPool:
                     writebuf(struct.pack('If', ent[0], ent[1] / total_len))
 
     def write_out_map(self, writebuf):
-        writebuf(struct.pack('I', len(self.pos)))
+        pos = array.array('f')
         for p in sorted(self.pos.items(), key=operator.itemgetter(1)):
-            writebuf(struct.pack('fff', p[0][0], p[0][1], p[0][2]))
+            pos.extend(p[0])
+        write_array(writebuf, 'f', pos, 3)
 
     def get_pos_idx(self, vert):
         pf = vert.co.copy().freeze()
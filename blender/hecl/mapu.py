@@ -1,4 +1,5 @@
-import bpy, os, struct
+import bpy, os, struct, array
+from .arrayframe import write_array
 
 def cook(writebuf):
     found_lib = False
@@ -27,13 +28,11 @@ def cook(writebuf):
                                  obj.matrix_local[1][0], obj.matrix_local[1][1], obj.matrix_local[1][2], obj.matrix_local[1][3],
                                  obj.matrix_local[2][0], obj.matrix_local[2][1], obj.matrix_local[2][2], obj.matrix_local[2][3],
                                  obj.matrix_local[3][0], obj.matrix_local[3][1], obj.matrix_local[3][2], obj.matrix_local[3][3]))
-            writebuf(struct.pack('I', len(obj.children)))
+            hexagons = array.array('f')
             for child in obj.children:
-                writebuf(struct.pack('ffffffffffffffff',
-                                     child.matrix_local[0][0], child.matrix_local[0][1], child.matrix_local[0][2], child.matrix_local[0][3],
-                                     child.matrix_local[1][0], child.matrix_local[1][1], child.matrix_local[1][2], child.matrix_local[1][3],
-                                     child.matrix_local[2][0], child.matrix_local[2][1], child.matrix_local[2][2], child.matrix_local[2][3],
-                                     child.matrix_local[3][0], child.matrix_local[3][1], child.matrix_local[3][2], child.matrix_local[3][3]))
+                for row in child.matrix_local:
+                    hexagons.extend(row)
+            write_array(writebuf, 'f', hexagons, 16)
             writebuf(struct.pack('ffff', obj.retro_mapworld_color[0], obj.retro_mapworld_color[1],
                                          obj.retro_mapworld_color[2], obj.retro_mapworld_color[3]))
             writebuf(struct.pack('I', len(obj.retro_mapworld_path)))
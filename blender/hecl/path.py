@@ -1,6 +1,7 @@
 import bpy, gpu, sys, bmesh, struct
 from mathutils import Vector
 from gpu_extras.batch import batch_for_shader
+from .arrayframe import write_bytes
 
 # Convenience class that automatically brings active edit mesh's face into scope for get/set
 class HeightRef:
@@ -216,8 +217,7 @@ def cook(writebuf, mesh_obj):
     ba += struct.pack('>II', 0, 0)
 
     # Write out
-    writebuf(struct.pack('I', len(ba)))
-    writebuf(ba)
+    write_bytes(writebuf, ba)
 
 try:
     line_shader = gpu.shader.from_builtin('3D_FLAT_COLOR')
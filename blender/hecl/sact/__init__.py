@@ -1,11 +1,12 @@
 from . import SACTSubtype, SACTAction, ANIM
 from .. import armature
+from ..arrayframe import write_array
 
 import bpy
 import bpy.path
-import re
 import struct
-from mathutils import Vector, Quaternion, Euler
+from array import array
+from mathutils import Vector
 
 # Actor data class
 class SACTData(bpy.types.PropertyGroup):
@@ -21,143 +22,42 @@ class SACTData(bpy.types.PropertyGroup):
     active_action: bpy.props.IntProperty(name="Active Actor Action", default=0, update=SACTAction.active_action_update)
     show_actions: bpy.props.BoolProperty()
 
-# Regex RNA path matchers
-scale_matcher = re.compile(r'pose.bones\["(\S+)"\].scale')
-rotation_matcher = re.compile(r'pose.bones\["(\S+)"\].rotation')
-location_matcher = re.compile(r'pose.bones\["(\S+)"\].location')
-
 def write_action_channels(writebuf, action):
-    # Set of frame indices
-    frame_set = set()
-
-    # Set of unique bone names
-    bone_set = []
-
-    # Scan through all fcurves to build animated bone set
-    for fcurve in action.fcurves:
-        data_path = fcurve.data_path
-        scale_match = scale_matcher.match(data_path)
-        rotation_match = rotation_matcher.match(data_path)
-        location_match = location_matcher.match(data_path)
-
-        if scale_match:
-            if scale_match.group(1) not in bone_set:
-                bone_set.append(scale_match.group(1))
-        elif rotation_match:
-            if rotation_match.group(1) not in bone_set:
-                bone_set.append(rotation_match.group(1))
-        elif location_match:
-            if location_match.group(1) not in bone_set:
-                bone_set.append(location_match.group(1))
-        else:
-            continue
-
-        # Count unified keyframes for interleaving channel data
-        for key in fcurve.keyframe_points:
-            frame_set.add(int(key.co[0]))
-
-    # Build bone table
-    bone_list = []
-    for bone in bone_set:
-        fc_dict = dict()
-        rotation_mode = None
-        property_bits = 0
-        for fcurve in action.fcurves:
-            if fcurve.data_path == 'pose.bones["'+bone+'"].scale':
-                if 'scale' not in fc_dict:
-                    fc_dict['scale'] = [None, None, None]
-                    property_bits |= 4
-                fc_dict['scale'][fcurve.array_index] = fcurve
-            elif fcurve.data_path == 'pose.bones["'+bone+'"].rotation_euler':
-                if 'rotation_euler' not in fc_dict:
-                    fc_dict['rotation_euler'] = [None, None, None]
-                    rotation_mode = 'rotation_euler'
-                    property_bits |= 1
-                fc_dict['rotation_euler'][fcurve.array_index] = fcurve
-            elif fcurve.data_path == 'pose.bones["'+bone+'"].rotation_quaternion':
-                if 'rotation_quaternion' not in fc_dict:
-                    fc_dict['rotation_quaternion'] = [None, None, None, None]
-                    rotation_mode = 'rotation_quaternion'
-                    property_bits |= 1
-                fc_dict['rotation_quaternion'][fcurve.array_index] = fcurve
-            elif fcurve.data_path == 'pose.bones["'+bone+'"].rotation_axis_angle':
-                if 'rotation_axis_angle' not in fc_dict:
-                    fc_dict['rotation_axis_angle'] = [None, None, None, None]
-                    rotation_mode = 'rotation_axis_angle'
-                    property_bits |= 1
-                fc_dict['rotation_axis_angle'][fcurve.array_index] = fcurve
-            elif fcurve.data_path == 'pose.bones["'+bone+'"].location':
-                if 'location' not in fc_dict:
-                    fc_dict['location'] = [None, None, None]
-                    property_bits |= 2
-                fc_dict['location'][fcurve.array_index] = fcurve
-        bone_list.append((bone, rotation_mode, fc_dict, property_bits))
+    # Group fcurves per-bone and gather unified keyframes in one pass
+    bone_list, frame_set = ANIM.group_bone_fcurves(action)
 
     # Write out frame indices
     sorted_frames = sorted(frame_set)
-    writebuf(struct.pack('I', len(sorted_frames)))
-    for frame in sorted_frames:
-        writebuf(struct.pack('i', frame))
+    write_array(writebuf, 'i', sorted_frames)
 
     # Interleave / interpolate keyframe data
     writebuf(struct.pack('I', len(bone_list)))
-    for bone in bone_list:
-
-        bone_name = bone[0]
-        rotation_mode = bone[1]
-        fc_dict = bone[2]
-        property_bits = bone[3]
-
-        writebuf(struct.pack('I', len(bone_name)))
-        writebuf(bone_name.encode())
+    for bone_name, rotation_mode, fc_dict in bone_list:
+        property_bits = 0
+        channels = []
+        if rotation_mode:
+            property_bits |= 1
+            channels.append(ANIM.sample_rotation(rotation_mode, fc_dict, sorted_frames, normalize=True))
+        if 'location' in fc_dict:
+            property_bits |= 2
+            channels.append(ANIM.sample_channel(fc_dict['location'], sorted_frames, 0.0))
+        if 'scale' in fc_dict:
+            property_bits |= 4
+            channels.append(ANIM.sample_channel(fc_dict['scale'], sorted_frames, 1.0))
+
+        bone_name_bytes = bone_name.encode()
+        writebuf(struct.pack('I', len(bone_name_bytes)))
+        writebuf(bone_name_bytes)
 
         writebuf(struct.pack('I', property_bits))
 
+        # Keys are rotation (4 floats), location (3) and scale (3) per frame, as present
         writebuf(struct.pack('I', len(sorted_frames)))
-        for frame in sorted_frames:
-
-            # Rotation curves
-            if rotation_mode == 'rotation_quaternion':
-                quat = [0.0]*4
-                for comp in range(4):
-                    if fc_dict['rotation_quaternion'][comp]:
-                        quat[comp] = fc_dict['rotation_quaternion'][comp].evaluate(frame)
-                quat = Quaternion(quat).normalized()
-                writebuf(struct.pack('ffff', quat[0], quat[1], quat[2], quat[3]))
-
-            elif rotation_mode == 'rotation_euler':
-                euler = [0.0]*3
-                for comp in range(3):
-                    if fc_dict['rotation_euler'][comp]:
-                        euler[comp] = fc_dict['rotation_euler'][comp].evaluate(frame)
-                euler_o = Euler(euler, 'XYZ')
-                quat = euler_o.to_quaternion()
-                writebuf(struct.pack('ffff', quat[0], quat[1], quat[2], quat[3]))
-
-            elif rotation_mode == 'rotation_axis_angle':
-                axis_angle = [0.0]*4
-                for comp in range(4):
-                    if fc_dict['rotation_axis_angle'][comp]:
-                        axis_angle[comp] = fc_dict['rotation_axis_angle'][comp].evaluate(frame)
-                quat = Quaternion(axis_angle[1:4], axis_angle[0])
-                writebuf(struct.pack('ffff', quat[0], quat[1], quat[2], quat[3]))
-
-            # Location curves
-            if 'location' in fc_dict:
-                writevec = [0.0]*3
-                for comp in range(3):
-                    if fc_dict['location'][comp]:
-                        writevec[comp] = fc_dict['location'][comp].evaluate(frame)
-                writebuf(struct.pack('fff', writevec[0], writevec[1], writevec[2]))
-
-            # Scale curves
-            if 'scale' in fc_dict:
-                writevec = [1.0]*3
-                for comp in range(3):
-                    if fc_dict['scale'][comp]:
-                        writevec[comp] = fc_dict['scale'][comp].evaluate(frame)
-                writebuf(struct.pack('fff', writevec[0], writevec[1], writevec[2]))
-
+        key_floats = array('f')
+        for f in range(len(sorted_frames)):
+            for channel in channels:
+                key_floats.extend(channel[f])
+        writebuf(key_floats.tobytes())
 
 def write_action_aabb(writebuf, arm_obj, mesh_obj, action):
     scene = bpy.context.scene
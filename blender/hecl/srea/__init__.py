@@ -399,8 +399,8 @@ look_left = Quaternion((0.0, 0.0, 1.0), math.radians(90.0)) @ Quaternion((1.0, 0
 look_right = Quaternion((0.0, 0.0, 1.0), math.radians(-90.0)) @ Quaternion((1.0, 0.0, 0.0), math.radians(90.0))
 look_list = (look_forward, look_backward, look_up, look_down, look_left, look_right)
 
-# Render PVS for location
-def render_pvs(pathOut, location):
+# Scene state shared by every PVS render; returns the cube camera object
+def pvs_setup():
     bpy.context.scene.render.resolution_x = 256
     bpy.context.scene.render.resolution_y = 256
     bpy.context.scene.render.resolution_percentage = 100
@@ -432,24 +432,53 @@ def render_pvs(pathOut, location):
                 slot.material = mat
             mat_idx += 1
 
-    cam_obj.location = location
     cam_obj.rotation_mode = 'QUATERNION'
+    return cam_obj
+
+def pvs_teardown(cam_obj):
+    cam = cam_obj.data
+    bpy.context.scene.camera = None
+    #bpy.context.scene.objects.unlink(cam_obj)
+    bpy.data.objects.remove(cam_obj)
+    bpy.data.cameras.remove(cam)
 
+# Render the six cube faces seen from location to pathOut0..pathOut5
+def pvs_render_cube(cam_obj, pathOut, location):
+    cam_obj.location = location
     for i in range(6):
         cam_obj.rotation_quaternion = look_list[i]
         bpy.context.scene.render.filepath = '%s%d' % (pathOut, i)
         bpy.ops.render.render(write_still=True)
 
-    bpy.context.scene.camera = None
-    #bpy.context.scene.objects.unlink(cam_obj)
-    bpy.data.objects.remove(cam_obj)
-    bpy.data.cameras.remove(cam)
+def pvs_light_location(lightName):
+    if lightName not in bpy.context.scene.objects:
+        raise RuntimeError('Unable to find light %s' % lightName)
+    return bpy.context.scene.objects[lightName].location
+
+# Render PVS for location
+def render_pvs(pathOut, location):
+    cam_obj = pvs_setup()
+    pvs_render_cube(cam_obj, pathOut, location)
+    pvs_teardown(cam_obj)
 
 # Render PVS for light
 def render_pvs_light(pathOut, lightName):
-    if lightName not in bpy.context.scene.objects:
-        raise RuntimeError('Unable to find light %s' % lightName)
-    render_pvs(pathOut, bpy.context.scene.objects[lightName].location)
+    render_pvs(pathOut, pvs_light_location(lightName))
+
+# Render many (pathOut, location-or-light-name) samples with one scene setup;
+# sample_done(idx, error) is called as each one finishes so results can be streamed
+def render_pvs_batch(samples, sample_done):
+    cam_obj = pvs_setup()
+    try:
+        for idx, (pathOut, source) in enumerate(samples):
+            try:
+                location = pvs_light_location(source) if isinstance(source, str) else source
+                pvs_render_cube(cam_obj, pathOut, location)
+                sample_done(idx, None)
+            except RuntimeError as e:
+                sample_done(idx, str(e))
+    finally:
+        pvs_teardown(cam_obj)
 
 # Cook
 def cook(writebuffunc, platform, endianchar):
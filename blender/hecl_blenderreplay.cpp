@@ -0,0 +1,158 @@
+/* hecl-blender-replay
+ *
+ * Stands in for blender + hecl_blendershell.py by replaying a session recorded
+ * with HECL_BLENDER_RECORD. Point BLENDER_BIN at this executable and
+ * HECL_BLENDER_REPLAY at the recording; it is launched with the same arguments
+ * hecl::blender::Connection passes to blender:
+ *
+ *   hecl-blender-replay --background -P <shell.py> -- <readfd> <writefd> <verbosity> <addon.zip>
+ *
+ * Data written by the connection is verified byte-for-byte against the
+ * recording and recorded replies are sent back in their original order.
+ * Any divergence is written to the same hecl_<pid>.derp error file the
+ * python shell uses, so the connection reports it like a blender exception.
+ */
+
+#include <array>
+#include <cerrno>
+#include <cinttypes>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#if _WIN32
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN 1
+#endif
+#include <windows.h>
+#include <fcntl.h>
+#include <io.h>
+#include <process.h>
+#define getpid _getpid
+#else
+#include <unistd.h>
+#endif
+
+namespace {
+
+constexpr std::array<char, 4> RecordMagic{'H', 'B', 'R', 'C'};
+constexpr uint32_t RecordVersion = 1;
+
+std::string ErrPath() {
+#if _WIN32
+  const char* tmp = std::getenv("TEMP");
+  std::string ret = tmp ? tmp : "/Temp";
+#else
+  const char* tmp = std::getenv("TMPDIR");
+  std::string ret = tmp ? tmp : "/tmp";
+#endif
+  char name[32];
+  std::snprintf(name, sizeof(name), "/hecl_%016" PRIX64 ".derp", uint64_t(getpid()));
+  return ret + name;
+}
+
+[[noreturn]] void Fail(const std::string& msg) {
+  std::fprintf(stderr, "hecl-blender-replay: %s\n", msg.c_str());
+  if (FILE* fp = std::fopen(ErrPath().c_str(), "w")) {
+    std::fprintf(fp, "hecl-blender-replay: %s\n", msg.c_str());
+    std::fclose(fp);
+  }
+  std::exit(1);
+}
+
+bool ReadAll(int fd, uint8_t* buf, std::size_t len) {
+  while (len) {
+    const auto ret = read(fd, buf, static_cast<unsigned>(len));
+    if (ret < 0 && errno == EINTR)
+      continue;
+    if (ret <= 0)
+      return false;
+    buf += ret;
+    len -= ret;
+  }
+  return true;
+}
+
+bool WriteAll(int fd, const uint8_t* buf, std::size_t len) {
+  while (len) {
+    const auto ret = write(fd, buf, static_cast<unsigned>(len));
+    if (ret < 0 && errno == EINTR)
+      continue;
+    if (ret <= 0)
+      return false;
+    buf += ret;
+    len -= ret;
+  }
+  return true;
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+  int argIdx = 1;
+  while (argIdx < argc && std::strcmp(argv[argIdx], "--") != 0)
+    ++argIdx;
+  if (argc - argIdx < 3) {
+    std::fprintf(stderr, "Usage: hecl-blender-replay [blender args] -- <readfd> <writefd> [verbosity] [addon]\n");
+    return 1;
+  }
+
+#if _WIN32
+  const int readfd = _open_osfhandle(intptr_t(std::strtoull(argv[argIdx + 1], nullptr, 10)), _O_RDONLY | _O_BINARY);
+  const int writefd = _open_osfhandle(intptr_t(std::strtoull(argv[argIdx + 2], nullptr, 10)), _O_WRONLY | _O_BINARY);
+#else
+  const int readfd = int(std::strtol(argv[argIdx + 1], nullptr, 10));
+  const int writefd = int(std::strtol(argv[argIdx + 2], nullptr, 10));
+#endif
+
+  const char* replayPath = std::getenv("HECL_BLENDER_REPLAY");
+  if (!replayPath || !replayPath[0])
+    Fail("HECL_BLENDER_REPLAY is not set");
+
+  FILE* fp = std::fopen(replayPath, "rb");
+  if (!fp)
+    Fail(std::string("unable to open recording ") + replayPath);
+
+  std::array<char, 4> magic{};
+  uint32_t version = 0;
+  if (std::fread(magic.data(), 1, magic.size(), fp) != magic.size() || magic != RecordMagic ||
+      std::fread(&version, 1, sizeof(version), fp) != sizeof(version) || version != RecordVersion)
+    Fail(std::string(replayPath) + " is not a hecl blender recording");
+
+  std::vector<uint8_t> expect;
+  std::vector<uint8_t> actual;
+  uint64_t offset = 0;
+  char direction;
+  while (std::fread(&direction, 1, 1, fp) == 1) {
+    uint32_t len;
+    if (std::fread(&len, 1, sizeof(len), fp) != sizeof(len))
+      Fail("truncated recording");
+    expect.resize(len);
+    if (std::fread(expect.data(), 1, len, fp) != len)
+      Fail("truncated recording");
+
+    if (direction == '>') {
+      actual.resize(len);
+      if (!ReadAll(readfd, actual.data(), len))
+        Fail("connection closed before end of recording");
+      if (actual != expect) {
+        std::size_t i = 0;
+        while (actual[i] == expect[i])
+          ++i;
+        Fail("connection diverged from recording at byte " + std::to_string(offset + i));
+      }
+      offset += len;
+    } else if (direction == '<') {
+      if (!WriteAll(writefd, expect.data(), len))
+        Fail("connection closed before end of recording");
+    } else {
+      Fail("corrupt recording");
+    }
+  }
+
+  std::fclose(fp);
+  return 0;
+}
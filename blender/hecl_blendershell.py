@@ -1,4 +1,4 @@
-import bpy, sys, os, re, struct, traceback
+import bpy, sys, os, re, struct, array, time, traceback
 
 ARGS_PATTERN = re.compile(r'''(?:"([^"]+)"|'([^']+)'|(\S+))''')
 
@@ -32,22 +32,75 @@ else:
 
 err_path += "/hecl_%016X.derp" % os.getpid()
 
+def readpipeexact(read_len):
+    # Pipelined commands may arrive split across reads
+    read_bytes = os.read(readfd, read_len)
+    while len(read_bytes) < read_len:
+        more = os.read(readfd, read_len - len(read_bytes))
+        if not more:
+            break
+        read_bytes += more
+    return read_bytes
+
 def readpipestr():
-    read_bytes = os.read(readfd, 4)
+    read_bytes = readpipeexact(4)
     if len(read_bytes) != 4:
         print('HECL connection lost or desynchronized')
         _quitblender()
     read_len = struct.unpack('I', read_bytes)[0]
-    return os.read(readfd, read_len)
+    return readpipeexact(read_len)
+
+# Per-command execution time (command receipt to final reply write), fetched with GETPROFILE
+cmd_profile = {}
+cmd_current = None
+cmd_start = 0.0
+cmd_last_write = 0.0
+# Set when the client sent the current command through DataStream::Pipeline
+cmd_pipelined = False
+
+def profile_command(name):
+    global cmd_current, cmd_start
+    if cmd_current is not None:
+        ent = cmd_profile.setdefault(cmd_current, [0, 0.0])
+        ent[0] += 1
+        if cmd_last_write > cmd_start:
+            ent[1] += cmd_last_write - cmd_start
+    cmd_current = name
+    cmd_start = time.perf_counter()
+
+# Replies to pipelined commands are held here until complete, so the first
+# reply byte tells the reader the whole reply is ready to decode
+reply_buffer = None
 
 def writepipestr(linebytes):
+    global cmd_last_write
     #print('LINE', linebytes)
+    if reply_buffer is not None:
+        reply_buffer.append(struct.pack('I', len(linebytes)))
+        reply_buffer.append(linebytes)
+        return
     os.write(writefd, struct.pack('I', len(linebytes)))
     os.write(writefd, linebytes)
+    cmd_last_write = time.perf_counter()
 
 def writepipebuf(linebytes):
+    global cmd_last_write
     #print('BUF', linebytes)
+    if reply_buffer is not None:
+        reply_buffer.append(linebytes)
+        return
     os.write(writefd, linebytes)
+    cmd_last_write = time.perf_counter()
+
+def flushreply():
+    global reply_buffer, cmd_last_write
+    if reply_buffer is None:
+        return
+    data = memoryview(b''.join(reply_buffer))
+    reply_buffer = None
+    while len(data):
+        data = data[os.write(writefd, data):]
+    cmd_last_write = time.perf_counter()
 
 def quitblender():
     writepipestr(b'QUITTING')
@@ -107,6 +160,7 @@ def count_brackets(linestr):
 
 # Read line of space-separated/quoted arguments
 def read_cmdargs():
+    global cmd_pipelined
     cmdline = readpipestr()
     if cmdline == b'':
         print('HECL connection lost')
@@ -114,6 +168,10 @@ def read_cmdargs():
     cmdargs = []
     for match in ARGS_PATTERN.finditer(cmdline.decode()):
         cmdargs.append(match.group(match.lastindex))
+    cmd_pipelined = len(cmdargs) > 1 and cmdargs[0] == 'PIPELINED'
+    if cmd_pipelined:
+        del cmdargs[0]
+    profile_command(cmdargs[0] if len(cmdargs) else '')
     return cmdargs
 
 # Complete sequences of statements compiled/executed here
@@ -204,36 +262,69 @@ def writelight(obj):
 
     writepipestr(obj.name.encode())
 
+def writemeshlist():
+    meshobjs = [obj for obj in bpy.data.objects if obj.type == 'MESH' and not obj.data.library]
+    writepipebuf(struct.pack('I', len(meshobjs)))
+    for meshobj in meshobjs:
+        writepipestr(meshobj.name.encode())
+
+def writelightlist():
+    lightobjs = [obj for obj in bpy.context.scene.objects if obj.type == 'LIGHT' and not obj.data.library]
+    writepipebuf(struct.pack('I', len(lightobjs)))
+    for obj in lightobjs:
+        writepipestr(obj.name.encode())
+
+def meshrigged():
+    meshName = bpy.context.scene.hecl_mesh_obj
+    return meshName in bpy.data.objects and len(bpy.data.objects[meshName].vertex_groups) != 0
+
+# Optional SCENEMANIFEST section behind a presence byte; a section that fails to resolve
+# (e.g. a subtype's linked mesh is missing) is sent as absent so the rest of the manifest
+# survives and the caller's per-command query reports the error instead
+def writemanifestsection(writer, applies):
+    if applies:
+        buf = []
+        try:
+            writer(buf.append)
+        except Exception as e:
+            print('SCENEMANIFEST section failed: %s' % e)
+        else:
+            writepipebuf(struct.pack('B', 1))
+            writepipebuf(b''.join(buf))
+            return
+    writepipebuf(struct.pack('B', 0))
+
 # Command loop for reading data from blender
 def dataout_loop():
+    global reply_buffer
     writepipestr(b'READY')
     while True:
+        flushreply()
         cmdargs = read_cmdargs()
         print(cmdargs)
+        if cmd_pipelined:
+            reply_buffer = []
 
         if cmdargs[0] == 'DATAEND':
             writepipestr(b'DONE')
             return
 
         elif cmdargs[0] == 'MESHLIST':
-            meshCount = 0
-            for meshobj in bpy.data.objects:
-                if meshobj.type == 'MESH' and not meshobj.data.library:
-                    meshCount += 1
-            writepipebuf(struct.pack('I', meshCount))
-            for meshobj in bpy.data.objects:
-                if meshobj.type == 'MESH' and not meshobj.data.library:
-                    writepipestr(meshobj.name.encode())
+            writemeshlist()
 
         elif cmdargs[0] == 'LIGHTLIST':
-            lightCount = 0
-            for obj in bpy.context.scene.objects:
-                if obj.type == 'LIGHT' and not obj.data.library:
-                    lightCount += 1
-            writepipebuf(struct.pack('I', lightCount))
-            for obj in bpy.context.scene.objects:
-                if obj.type == 'LIGHT' and not obj.data.library:
-                    writepipestr(obj.name.encode())
+            writelightlist()
+
+        elif cmdargs[0] == 'SCENEMANIFEST':
+            # Everything DataSpecs query ahead of compiling, in one reply
+            writepipestr(b'OK')
+            writemeshlist()
+            writelightlist()
+            heclType = bpy.context.scene.hecl_type
+            writemanifestsection(hecl.mesh_aabb, heclType in ('MESH', 'ACTOR'))
+            writemanifestsection(hecl.sact.get_subtype_names, heclType == 'ACTOR')
+            writemanifestsection(hecl.sact.get_action_names, heclType == 'ACTOR')
+            writemanifestsection(hecl.sact.get_attachment_names, heclType == 'ACTOR')
 
         elif cmdargs[0] == 'MESHAABB':
             writepipestr(b'OK')
@@ -313,8 +404,7 @@ def dataout_loop():
             writepipestr(b'OK')
             buffer = hecl.frme.cook(writepipebuf, version, PathHasher())
             writepipestr(b'FRAMEDONE')
-            writepipebuf(struct.pack('I', len(buffer)))
-            writepipebuf(buffer)
+            hecl.arrayframe.write_bytes(writepipebuf, buffer)
 
         elif cmdargs[0] == 'LIGHTCOMPILEALL':
             writepipestr(b'OK')
@@ -415,13 +505,16 @@ def dataout_loop():
                 continue
 
             writepipestr(b'OK')
-            writepipebuf(struct.pack('I', len(armObj.data.bones)))
-            for bone in armObj.data.bones:
-                writepipebuf(struct.pack('I', len(bone.name)))
-                writepipebuf(bone.name.encode())
+            bones = armObj.data.bones
+            writepipebuf(struct.pack('I', len(bones)))
+            mats = array.array('f')
+            for bone in bones:
+                name = bone.name.encode()
+                writepipebuf(struct.pack('I', len(name)))
+                writepipebuf(name)
                 for r in bone.matrix_local.to_3x3():
-                    for c in r:
-                        writepipebuf(struct.pack('f', c))
+                    mats.extend(r)
+            hecl.arrayframe.write_array(writepipebuf, 'f', mats, 9)
 
         elif cmdargs[0] == 'RENDERPVS':
             pathOut = cmdargs[1]
@@ -437,6 +530,20 @@ def dataout_loop():
             hecl.srea.render_pvs_light(pathOut, lightName)
             writepipestr(b'OK')
 
+        elif cmdargs[0] == 'RENDERPVSBATCH':
+            # Whole sample list arrives up front; one reply per sample follows as it is rendered
+            sampleCount = struct.unpack('I', readpipeexact(4))[0]
+            samples = []
+            for i in range(sampleCount):
+                pathOut = readpipestr().decode()
+                if readpipeexact(1)[0]:
+                    samples.append((pathOut, readpipestr().decode()))
+                else:
+                    samples.append((pathOut, struct.unpack('fff', readpipeexact(12))))
+            writepipestr(b'OK')
+            hecl.srea.render_pvs_batch(samples,
+                lambda idx, err: writepipestr(err.encode() if err else b'OK'))
+
         elif cmdargs[0] == 'MAPAREACOMPILE':
             if 'MAP' not in bpy.data.objects:
                 writepipestr(('"MAP" object not in .blend').encode())
@@ -469,7 +576,10 @@ try:
                 if bpy.ops.object.mode_set.poll():
                     bpy.ops.object.mode_set(mode = 'OBJECT')
                 loaded_blend = cmdargs[1]
+                # Type and rig state ride along so opening is a single round-trip
                 writepipestr(b'FINISHED')
+                writepipestr(bpy.context.scene.hecl_type.encode())
+                writepipestr(b'TRUE' if meshrigged() else b'FALSE')
             else:
                 writepipestr(b'CANCELLED')
 
@@ -491,15 +601,16 @@ try:
         elif cmdargs[0] == 'GETTYPE':
             writepipestr(bpy.context.scene.hecl_type.encode())
 
+        elif cmdargs[0] == 'GETPROFILE':
+            writepipebuf(struct.pack('I', len(cmd_profile)))
+            for name, ent in cmd_profile.items():
+                name_bytes = name.encode()
+                writepipebuf(struct.pack('I', len(name_bytes)))
+                writepipebuf(name_bytes)
+                writepipebuf(struct.pack('=Id', ent[0], ent[1]))
+
         elif cmdargs[0] == 'GETMESHRIGGED':
-            meshName = bpy.context.scene.hecl_mesh_obj
-            if meshName not in bpy.data.objects:
-                writepipestr(b'FALSE')
-            else:
-                if len(bpy.data.objects[meshName].vertex_groups):
-                    writepipestr(b'TRUE')
-                else:
-                    writepipestr(b'FALSE')
+            writepipestr(b'TRUE' if meshrigged() else b'FALSE')
 
         elif cmdargs[0] == 'SAVE':
             bpy.context.preferences.filepaths.save_version = 0
@@ -574,6 +685,7 @@ try:
             try:
                 dataout_loop()
             except Exception as e:
+                flushreply()
                 writepipestr(b'EXCEPTION')
                 raise
 
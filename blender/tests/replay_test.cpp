@@ -0,0 +1,19 @@
+/* Drives hecl::blender::Connection against hecl-blender-replay.
+ *
+ * CTest points BLENDER_BIN at hecl-blender-replay and HECL_BLENDER_REPLAY at a
+ * recorded session. Any byte the connection writes that diverges from the
+ * recording ends the replay, which the connection reports as a blender
+ * failure, so the test fails through logvisor. */
+
+#include "hecl/Blender/Connection.hpp"
+#include "logvisor/logvisor.hpp"
+
+int main() {
+  logvisor::RegisterStandardExceptions();
+  logvisor::RegisterConsoleLogger();
+
+  hecl::blender::Connection conn;
+  conn.quitBlender();
+
+  return logvisor::ErrorCount ? 1 : 0;
+}
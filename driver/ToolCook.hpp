@@ -153,7 +153,7 @@ public:
     for (const hecl::ProjectPath& path : m_selectedItems)
       m_useProj->cookPath(path, printer, m_recursive, m_info.force, m_fast, m_spec, &cp);
     cp.waitUntilComplete();
-    return 0;
+    return cp.failedCookCount() ? 1 : 0;
   }
 
   void cancel() override { m_useProj->interruptCook(); }
@@ -14,11 +14,16 @@
 
 #include <array>
 #include <atomic>
+#include <chrono>
 #include <cstddef>
 #include <cstdint>
 #include <cstdio>
+#include <cstring>
+#include <deque>
 #include <functional>
+#include <future>
 #include <memory>
+#include <memory_resource>
 #include <optional>
 #include <ostream>
 #include <string>
@@ -29,6 +34,7 @@
 
 #include "hecl/hecl.hpp"
 #include "hecl/Backend.hpp"
+#include "hecl/Blender/Token.hpp"
 #include "hecl/HMDLMeta.hpp"
 #include "hecl/TypedVariant.hpp"
 
@@ -109,6 +115,7 @@ public:
 
 /* Vector types with integrated stream reading constructor */
 struct Vector2f {
+  static constexpr uint8_t FrameWidth = 2;
   atVec2f val;
   Vector2f() = default;
   void read(Connection& conn);
@@ -120,6 +127,7 @@ struct Vector2f {
   }
 };
 struct Vector3f {
+  static constexpr uint8_t FrameWidth = 3;
   atVec3f val;
   Vector3f() = default;
   void read(Connection& conn);
@@ -132,6 +140,7 @@ struct Vector3f {
   }
 };
 struct Vector4f {
+  static constexpr uint8_t FrameWidth = 4;
   atVec4f val;
   Vector4f() = default;
   void read(Connection& conn);
@@ -150,6 +159,7 @@ struct Matrix3f {
   const atVec3f& operator[](std::size_t idx) const { return m[idx]; }
 };
 struct Matrix4f {
+  static constexpr uint8_t FrameWidth = 16;
   std::array<atVec4f, 4> val;
   Matrix4f() = default;
   Matrix4f(Connection& conn) { read(conn); }
@@ -181,6 +191,25 @@ struct Boolean {
 atVec3f MtxVecMul4RM(const Matrix4f& mtx, const Vector3f& vec);
 atVec3f MtxVecMul3RM(const Matrix4f& mtx, const Vector3f& vec);
 
+/** Region backing one decoded intermediate (Mesh, ColMesh, World, Actor). Its containers and everything
+ *  nested in them allocate from here, and the region is released wholesale with the intermediate.
+ *  Moving an intermediate, by construction or assignment, keeps the source's region alive with the
+ *  destination, since moved elements still point into it. Copies start from the default resource.
+ *  A container moved out of an intermediate on its own must not outlive it. */
+class DecodeArena {
+  using Region = std::pmr::monotonic_buffer_resource;
+  /* Own region first, then the regions of intermediates moved into this one */
+  std::vector<std::shared_ptr<Region>> m_regions{std::make_shared<Region>()};
+
+public:
+  DecodeArena() = default;
+  DecodeArena(const DecodeArena&) : DecodeArena() {}
+  DecodeArena(DecodeArena&& other) noexcept : m_regions(other.m_regions) {}
+  DecodeArena& operator=(const DecodeArena&) { return *this; }
+  DecodeArena& operator=(DecodeArena&& other) noexcept;
+  std::pmr::memory_resource* resource() const { return m_regions.front().get(); }
+};
+
 /** Intermediate material representation */
 struct Material {
   enum class ShaderType : uint32_t {
@@ -275,14 +304,14 @@ struct Material {
     Additive = 2
   };
 
-  std::string name;
+  std::pmr::string name;
   uint32_t passIndex;
   ShaderType shaderType;
-  std::vector<Chunk> chunks;
-  std::unordered_map<std::string, int32_t> iprops;
+  std::pmr::vector<Chunk> chunks;
+  std::pmr::unordered_map<std::pmr::string, int32_t> iprops;
   BlendMode blendMode = BlendMode::Opaque;
 
-  explicit Material(Connection& conn);
+  Material(Connection& conn, std::pmr::memory_resource* res);
   bool operator==(const Material& other) const {
     return chunks == other.chunks && iprops == other.iprops && blendMode == other.blendMode;
   }
@@ -294,6 +323,9 @@ struct Mesh {
   static constexpr std::size_t MaxUVLayers = 8;
   static constexpr std::size_t MaxSkinEntries = 16;
 
+  /* Backs every container below; declared first so it outlives them */
+  DecodeArena arena;
+
   HMDLTopology topology;
 
   /* Object transform in scene */
@@ -303,20 +335,20 @@ struct Mesh {
   Vector3f aabbMin;
   Vector3f aabbMax;
 
-  std::vector<std::vector<Material>> materialSets;
+  std::pmr::vector<std::pmr::vector<Material>> materialSets{arena.resource()};
 
   /* Vertex buffer data */
-  std::vector<Vector3f> pos;
-  std::vector<Vector3f> norm;
+  std::pmr::vector<Vector3f> pos{arena.resource()};
+  std::pmr::vector<Vector3f> norm{arena.resource()};
   uint32_t colorLayerCount = 0;
-  std::vector<Vector3f> color;
+  std::pmr::vector<Vector3f> color{arena.resource()};
   uint32_t uvLayerCount = 0;
-  std::vector<Vector2f> uv;
+  std::pmr::vector<Vector2f> uv{arena.resource()};
   uint32_t luvLayerCount = 0;
-  std::vector<Vector2f> luv;
+  std::pmr::vector<Vector2f> luv{arena.resource()};
 
   /* Skinning data */
-  std::vector<std::string> boneNames;
+  std::pmr::vector<std::pmr::string> boneNames{arena.resource()};
   struct SkinBind {
     uint32_t vg_idx = UINT32_MAX;
     float weight = 0.f;
@@ -325,8 +357,8 @@ struct Mesh {
     bool valid() const { return vg_idx != UINT32_MAX; }
     bool operator==(const SkinBind& other) const { return vg_idx == other.vg_idx && weight == other.weight; }
   };
-  std::vector<std::array<SkinBind, MaxSkinEntries>> skins;
-  std::vector<std::size_t> contiguousSkinVertCounts;
+  std::pmr::vector<std::array<SkinBind, MaxSkinEntries>> skins{arena.resource()};
+  std::pmr::vector<std::size_t> contiguousSkinVertCounts{arena.resource()};
 
   static std::size_t countSkinBinds(const std::array<SkinBind, MaxSkinEntries>& arr) {
     std::size_t ret = 0;
@@ -341,12 +373,12 @@ struct Mesh {
 
   /** Islands of the same material/skinBank are represented here */
   struct Surface {
-    Vector3f centroid;
-    uint32_t materialIdx;
-    Vector3f aabbMin;
-    Vector3f aabbMax;
-    Vector3f reflectionNormal;
-    uint32_t skinBankIdx;
+    Vector3f centroid = {};
+    uint32_t materialIdx = 0;
+    Vector3f aabbMin = {};
+    Vector3f aabbMax = {};
+    Vector3f reflectionNormal = {};
+    uint32_t skinBankIdx = 0;
 
     /** Vertex indexing data (all primitives joined as degenerate tri-strip) */
     struct Vert {
@@ -359,23 +391,29 @@ struct Mesh {
 
       bool operator==(const Vert& other) const;
     };
-    std::vector<Vert> verts;
+    std::pmr::vector<Vert> verts;
+
+    Surface() = default;
+    explicit Surface(std::pmr::memory_resource* res) : verts(res) {}
   };
-  std::vector<Surface> surfaces;
+  std::pmr::vector<Surface> surfaces{arena.resource()};
 
-  std::unordered_map<std::string, std::string> customProps;
+  std::pmr::unordered_map<std::pmr::string, std::pmr::string> customProps{arena.resource()};
 
   struct SkinBanks {
     struct Bank {
-      std::vector<uint32_t> m_skinIdxs;
-      std::vector<uint32_t> m_boneIdxs;
+      std::pmr::vector<uint32_t> m_skinIdxs;
+      std::pmr::vector<uint32_t> m_boneIdxs;
 
+      explicit Bank(std::pmr::memory_resource* res) : m_skinIdxs(res), m_boneIdxs(res) {}
       void addSkins(const Mesh& parent, const std::vector<uint32_t>& skinIdxs);
     };
-    std::vector<Bank> banks;
-    std::vector<Bank>::iterator addSkinBank(int skinSlotCount);
+    std::pmr::vector<Bank> banks;
+    explicit SkinBanks(std::pmr::memory_resource* res) : banks(res) {}
+    std::pmr::vector<Bank>::iterator addSkinBank(int skinSlotCount);
     uint32_t addSurface(const Mesh& mesh, const Surface& surf, int skinSlotCount);
-  } skinBanks;
+  };
+  SkinBanks skinBanks{arena.resource()};
 
   Mesh(Connection& conn, HMDLTopology topology, int skinSlotCount, bool useLuvs = false);
 
@@ -389,9 +427,12 @@ struct Mesh {
 
 /** Intermediate collision mesh representation prepared by blender from a single mesh object */
 struct ColMesh {
+  /* Backs every container below; declared first so it outlives them */
+  DecodeArena arena;
+
   /** HECL source and metadata of each material */
   struct Material {
-    std::string name;
+    std::pmr::string name;
     bool unknown;
     bool surfaceStone;
     bool surfaceMetal;
@@ -435,18 +476,18 @@ struct ColMesh {
     bool spiderBall;
     bool screwAttackWallJump;
 
-    Material(Connection& conn);
+    Material(Connection& conn, std::pmr::memory_resource* res);
   };
-  std::vector<Material> materials;
+  std::pmr::vector<Material> materials{arena.resource()};
 
-  std::vector<Vector3f> verts;
+  std::pmr::vector<Vector3f> verts{arena.resource()};
 
   struct Edge {
     std::array<uint32_t, 2> verts;
     bool seam;
     Edge(Connection& conn);
   };
-  std::vector<Edge> edges;
+  std::pmr::vector<Edge> edges{arena.resource()};
 
   struct Triangle {
     std::array<uint32_t, 3> edges;
@@ -454,13 +495,16 @@ struct ColMesh {
     bool flip;
     Triangle(Connection& conn);
   };
-  std::vector<Triangle> trianges;
+  std::pmr::vector<Triangle> trianges{arena.resource()};
 
   ColMesh(Connection& conn);
 };
 
 /** Intermediate world representation */
 struct World {
+  /* Backs every container below; declared first so it outlives them */
+  DecodeArena arena;
+
   struct Area {
     ProjectPath path;
     std::array<Vector3f, 2> aabb;
@@ -471,10 +515,10 @@ struct World {
       Index targetDock;
       Dock(Connection& conn);
     };
-    std::vector<Dock> docks;
-    Area(Connection& conn);
+    std::pmr::vector<Dock> docks;
+    Area(Connection& conn, std::pmr::memory_resource* res);
   };
-  std::vector<Area> areas;
+  std::pmr::vector<Area> areas{arena.resource()};
   World(Connection& conn);
 };
 
@@ -542,33 +586,57 @@ struct MapUniverse {
 
 /** Intermediate bone representation used in Armature */
 struct Bone {
-  std::string name;
+  std::pmr::string name;
   Vector3f origin;
   int32_t parent = -1;
-  std::vector<int32_t> children;
-  Bone(Connection& conn);
+  std::pmr::vector<int32_t> children;
+  Bone(Connection& conn, std::pmr::memory_resource* res);
 };
 
 /** Intermediate armature representation used in Actor */
 struct Armature {
-  std::vector<Bone> bones;
-  const Bone* lookupBone(const char* name) const;
+  /** Read-only view of m_bones so the name index and root stay in step with the bones */
+  const std::pmr::vector<Bone>& bones;
+  const std::pmr::vector<Bone>& getBones() const { return m_bones; }
+  const Bone* lookupBone(std::string_view name) const;
+  /** Index of the named bone, or -1 */
+  int32_t lookupBoneIdx(std::string_view name) const;
   const Bone* getParent(const Bone* bone) const;
   const Bone* getChild(const Bone* bone, std::size_t child) const;
   const Bone* getRoot() const;
-  Armature(Connection& conn);
+  /** Indices from bone up through its ancestors to the root, bone first */
+  std::vector<int32_t> getParentChain(const Bone* bone) const;
+  bool isAncestor(const Bone* ancestor, const Bone* bone) const;
+  explicit Armature(Connection& conn, std::pmr::memory_resource* res = std::pmr::get_default_resource());
+  /* bones always refers to this armature's own m_bones */
+  Armature(const Armature& other)
+  : bones(m_bones), m_bones(other.m_bones), m_nameIndex(other.m_nameIndex), m_rootIdx(other.m_rootIdx) {}
+  Armature(Armature&& other) noexcept
+  : bones(m_bones)
+  , m_bones(std::move(other.m_bones))
+  , m_nameIndex(std::move(other.m_nameIndex))
+  , m_rootIdx(other.m_rootIdx) {}
+  Armature& operator=(const Armature& other);
+  Armature& operator=(Armature&& other) noexcept;
+
+private:
+  std::pmr::vector<Bone> m_bones;
+  /* (name hash, bone index) sorted by hash */
+  std::pmr::vector<std::pair<uint64_t, int32_t>> m_nameIndex;
+  int32_t m_rootIdx = -1;
+  void buildIndex();
 };
 
 /** Intermediate action representation used in Actor */
 struct Action {
-  std::string name;
-  std::string animId;
+  std::pmr::string name;
+  std::pmr::string animId;
   float interval;
   bool additive;
   bool looping;
-  std::vector<int32_t> frames;
+  std::pmr::vector<int32_t> frames;
   struct Channel {
-    std::string boneName;
+    std::pmr::string boneName;
     uint32_t attrMask;
     struct Key {
       Vector4f rotation;
@@ -576,48 +644,51 @@ struct Action {
       Vector3f scale;
       Key(Connection& conn, uint32_t attrMask);
     };
-    std::vector<Key> keys;
-    Channel(Connection& conn);
+    std::pmr::vector<Key> keys;
+    Channel(Connection& conn, std::pmr::memory_resource* res);
   };
-  std::vector<Channel> channels;
-  std::vector<std::pair<Vector3f, Vector3f>> subtypeAABBs;
-  Action(Connection& conn);
+  std::pmr::vector<Channel> channels;
+  std::pmr::vector<std::pair<Vector3f, Vector3f>> subtypeAABBs;
+  explicit Action(Connection& conn, std::pmr::memory_resource* res = std::pmr::get_default_resource());
 };
 
 /** Intermediate actor representation prepared by blender from a single HECL actor blend */
 struct Actor {
+  /* Backs every container below; declared first so it outlives them */
+  DecodeArena arena;
+
   struct ActorArmature {
-    std::string name;
+    std::pmr::string name;
     ProjectPath path;
     std::optional<Armature> armature;
-    ActorArmature(Connection& conn);
+    ActorArmature(Connection& conn, std::pmr::memory_resource* res);
   };
-  std::vector<ActorArmature> armatures;
+  std::pmr::vector<ActorArmature> armatures{arena.resource()};
 
   struct Subtype {
-    std::string name;
-    std::string cskrId;
+    std::pmr::string name;
+    std::pmr::string cskrId;
     ProjectPath mesh;
     int32_t armature = -1;
     struct OverlayMesh {
-      std::string name;
-      std::string cskrId;
+      std::pmr::string name;
+      std::pmr::string cskrId;
       ProjectPath mesh;
-      OverlayMesh(Connection& conn);
+      OverlayMesh(Connection& conn, std::pmr::memory_resource* res);
     };
-    std::vector<OverlayMesh> overlayMeshes;
-    Subtype(Connection& conn);
+    std::pmr::vector<OverlayMesh> overlayMeshes;
+    Subtype(Connection& conn, std::pmr::memory_resource* res);
   };
-  std::vector<Subtype> subtypes;
+  std::pmr::vector<Subtype> subtypes{arena.resource()};
   struct Attachment {
-    std::string name;
-    std::string cskrId;
+    std::pmr::string name;
+    std::pmr::string cskrId;
     ProjectPath mesh;
     int32_t armature = -1;
-    Attachment(Connection& conn);
+    Attachment(Connection& conn, std::pmr::memory_resource* res);
   };
-  std::vector<Attachment> attachments;
-  std::vector<Action> actions;
+  std::pmr::vector<Attachment> attachments{arena.resource()};
+  std::pmr::vector<Action> actions{arena.resource()};
 
   Actor(Connection& conn);
 };
@@ -628,16 +699,141 @@ struct PathMesh {
   PathMesh(Connection& conn);
 };
 
+/** Scene metadata DataSpecs query ahead of compiling, gathered in one round-trip */
+struct SceneManifest {
+  std::vector<std::string> meshes;
+  std::vector<std::string> lights;
+  /** MESH and ACTOR blends only; also absent when blender failed to resolve the section,
+   *  in which case the per-command query reports the error */
+  std::optional<std::pair<atVec3f, atVec3f>> aabb;
+  /** ACTOR blends only, with the same failure rule */
+  std::optional<std::vector<std::pair<std::string, std::string>>> subtypes;
+  std::optional<std::vector<std::pair<std::string, std::string>>> actions;
+  std::optional<std::vector<std::pair<std::string, std::string>>> attachments;
+};
+
+/** PVS sample point for DataStream::renderPvsBatch; cube faces are rendered to <path>0 through <path>5 */
+struct PvsSample {
+  std::string path;
+  /** Camera location, or the name of a light to render from */
+  std::variant<atVec3f, std::string> source;
+};
+
+/** Pipe protocol counters for one command type, keyed by the command's first word */
+struct CommandStats {
+  uint64_t count = 0;
+  uint64_t bytesOut = 0;
+  uint64_t bytesIn = 0;
+  uint64_t readCalls = 0;
+  uint64_t writeCalls = 0;
+  std::chrono::nanoseconds readBlocked{};
+  std::chrono::nanoseconds writeBlocked{};
+  /** Issue to last pipe activity; includes blender execution, transfer and C++ decode */
+  std::chrono::nanoseconds wallTime{};
+  /** Execution time measured inside blender, filled in by Connection::fetchBlenderProfile() */
+  uint64_t blenderCount = 0;
+  std::chrono::nanoseconds blenderTime{};
+  /** Bucket i counts commands whose wall time fell in [2^i, 2^(i+1)) microseconds */
+  std::array<uint32_t, 32> wallHistogram{};
+};
+
 class DataStream {
   friend class Connection;
   Connection* m_parent;
   DataStream(Connection* parent);
 
+  /* Command issue and reply decode halves shared by the synchronous and pipelined interfaces */
+  void _issueMeshList(bool pipelined = false);
+  void _issueLightList(bool pipelined = false);
+  std::vector<std::string> _replyNameList();
+  void _issueMeshAABB(bool pipelined = false);
+  std::pair<atVec3f, atVec3f> _replyMeshAABB();
+  void _issueMesh(std::string_view name, bool useLuv, bool pipelined = false);
+  Mesh _replyMesh(HMDLTopology topology, int skinSlotCount, bool useLuv);
+  void _issueColMesh(std::string_view name, bool pipelined = false);
+  ColMesh _replyColMesh();
+  void _issueTextures(bool pipelined = false);
+  std::vector<ProjectPath> _replyTextures();
+  std::vector<std::pair<std::string, std::string>> _replyNamePairs();
+
 public:
+  /** Queues commands so blender processes them back-to-back while earlier replies are decoded.
+   *  Handlers run in issue order; at most maxInFlight replies are outstanding at once.
+   *  Drain the pipeline before making synchronous calls on the same DataStream.
+   *
+   *  Overloads without a handler return a deferred future instead. Its get() or wait() dispatches
+   *  replies in order until its own has been decoded, so it must be called on the thread driving
+   *  the pipeline. wait_for() reports std::future_status::deferred; poll replyReady() instead.
+   *  Futures are complete once the pipeline is destroyed. */
+  class Pipeline {
+    DataStream& m_stream;
+    /* Each reply keeps its command's stats so decode time is attributed to the right command */
+    std::deque<std::pair<CommandStats*, std::function<void()>>> m_replies;
+    std::size_t m_maxInFlight;
+    void _reserve();
+    void _push(std::function<void()> reply);
+
+  public:
+    template <typename T>
+    using Handler = std::function<void(T&&)>;
+
+  private:
+    template <typename T>
+    std::pair<std::future<T>, Handler<T>> _deferred() {
+      auto value = std::make_shared<std::optional<T>>();
+      /* Every queued reply runs its handler, so dispatching in order always reaches this one */
+      auto future = std::async(std::launch::deferred, [this, value]() {
+        while (!*value && dispatchOne()) {}
+        return std::move(**value);
+      });
+      return {std::move(future), [value](T&& v) { value->emplace(std::move(v)); }};
+    }
+
+  public:
+    explicit Pipeline(DataStream& stream, std::size_t maxInFlight = 8);
+    Pipeline(const Pipeline&) = delete;
+    Pipeline& operator=(const Pipeline&) = delete;
+    ~Pipeline() { drain(); }
+
+    std::size_t inFlight() const { return m_replies.size(); }
+
+    /** Decode the oldest outstanding reply; returns false if none are outstanding */
+    bool dispatchOne();
+    void drain();
+
+    /** True once blender has finished the oldest outstanding reply. The shell holds pipelined replies until
+     *  they are complete, so dispatchOne() then only waits on the pipe transfer, not on cooking. */
+    bool replyReady(std::chrono::milliseconds timeout = {}) const;
+
+    /** Wait up to timeout for any of the pipelines (each on its own connection) to have a reply ready and
+     *  dispatch one reply on every ready pipeline. Lets a single thread keep several blender instances busy.
+     *  Returns the number of replies dispatched. */
+    static std::size_t DispatchReady(const std::vector<Pipeline*>& pipelines, std::chrono::milliseconds timeout);
+
+    void getMeshList(Handler<std::vector<std::string>> handler);
+    void getLightList(Handler<std::vector<std::string>> handler);
+    void getMeshAABB(Handler<std::pair<atVec3f, atVec3f>> handler);
+    void compileMesh(std::string_view name, HMDLTopology topology, Handler<Mesh> handler, int skinSlotCount = 10,
+                     bool useLuv = false);
+    void compileColMesh(std::string_view name, Handler<ColMesh> handler);
+    void getTextures(Handler<std::vector<ProjectPath>> handler);
+
+    std::future<std::vector<std::string>> getMeshList();
+    std::future<std::vector<std::string>> getLightList();
+    std::future<std::pair<atVec3f, atVec3f>> getMeshAABB();
+    std::future<Mesh> compileMesh(std::string_view name, HMDLTopology topology, int skinSlotCount = 10,
+                                  bool useLuv = false);
+    std::future<ColMesh> compileColMesh(std::string_view name);
+    std::future<std::vector<ProjectPath>> getTextures();
+  };
+
   DataStream(const DataStream& other) = delete;
   DataStream(DataStream&& other) : m_parent(other.m_parent) { other.m_parent = nullptr; }
   ~DataStream() { close(); }
   void close();
+  /** Fetched once per loaded blend and kept by the connection until the blend changes or python runs.
+   *  The list and name queries below answer from it when it is present. */
+  const SceneManifest& getSceneManifest();
   std::vector<std::string> getMeshList();
   std::vector<std::string> getLightList();
   std::pair<atVec3f, atVec3f> getMeshAABB();
@@ -683,6 +879,10 @@ public:
 
   bool renderPvs(std::string_view path, const atVec3f& location);
   bool renderPvsLight(std::string_view path, std::string_view lightName);
+  /** Render all samples in one blender command sharing scene setup. onRendered(index, success) is
+   *  called as each sample's images are written. Returns the number rendered successfully. */
+  std::size_t renderPvsBatch(const std::vector<PvsSample>& samples,
+                             const std::function<void(std::size_t, bool)>& onRendered = {});
 
   MapArea compileMapArea();
   MapUniverse compileMapUniverse();
@@ -719,6 +919,11 @@ class Connection {
   bool m_pyStreamActive = false;
   bool m_dataStreamActive = false;
   bool m_blenderQuit = false;
+  bool m_recoverable = false;
+  bool m_died = false;
+  RecyclePolicy m_recyclePolicy;
+  unsigned m_meshThreads = 0;
+  uint32_t m_openedBlends = 0;
 #if _WIN32
   PROCESS_INFORMATION m_pinfo = {};
   std::thread m_consoleThread;
@@ -731,22 +936,106 @@ class Connection {
   BlendType m_loadedType = BlendType::None;
   bool m_loadedRigged = false;
   ProjectPath m_loadedBlend;
+  std::optional<SceneManifest> m_sceneManifest;
+  std::pair<BlendType, bool> _readOpenInfo();
   hecl::SystemString m_errPath;
+  hecl::UniqueFilePtr m_recordFile;
+  std::unordered_map<std::string, CommandStats> m_commandStats;
+  bool m_statsDump = false;
+
+  /* Reply cache (HECL_BLENDER_CACHE). Replies of cacheable DataStream calls are stored under the
+   * project's .hecl/blendercache keyed by the content of the blend and its linked libraries, addon
+   * stamp and command. On a hit the reply is decoded from memory, and the OPEN/DATABEGIN that would
+   * precede it are deferred until a command actually has to reach blender. */
+  bool m_cacheEnabled = false;
+  hecl::SystemString m_cacheDir;
+  uint64_t m_blendHash = 0;
+  bool m_openDeferred = false;
+  bool m_dataDeferred = false;
+  bool m_cacheNext = false;
+  bool m_replaying = false;
+  bool m_capturing = false;
+  std::string m_cacheKey;
+  std::vector<uint8_t> m_replyBuf;
+  std::size_t m_replyPos = 0;
+  std::string _cacheKey(std::string_view cmd) const;
+  std::optional<std::vector<uint8_t>> _loadCacheEntry(std::string_view key) const;
+  void _storeCacheEntry(std::string_view key, const std::vector<uint8_t>& data) const;
+  void _resumeDeferred();
+  void _endCachedReply();
+  /** Makes the next command served from, or stored to, the reply cache until destroyed */
+  class CachedReply {
+    friend class Connection;
+    Connection* m_conn;
+    explicit CachedReply(Connection* conn) : m_conn(conn) { conn->m_cacheNext = conn->m_blendHash && !conn->m_died; }
+
+  public:
+    CachedReply(const CachedReply&) = delete;
+    CachedReply& operator=(const CachedReply&) = delete;
+    ~CachedReply() { m_conn->_endCachedReply(); }
+  };
+  CachedReply _cacheReply() { return CachedReply(this); }
+
+  CommandStats* m_curStats = nullptr;
+  std::chrono::steady_clock::time_point m_curCommandStart;
+  std::chrono::steady_clock::time_point m_lastPipeIo;
+  void _beginCommandStats(CommandStats* stats);
+  void _finishCommandStats();
+  void _writeCommand(std::string_view cmd, bool pipelined = false);
+  int _pipeRead(void* buf, std::size_t len);
+  /** Wait up to timeout for unread reply data from blender; always true once blender has died */
+  bool _replyAvailable(std::chrono::milliseconds timeout) const;
+  int _pipeWrite(const void* buf, std::size_t len);
+  std::chrono::steady_clock::duration m_startupDuration{};
+  void _recordChunk(char direction, const void* buf, std::size_t len);
   uint32_t _readStr(char* buf, uint32_t bufSz);
   uint32_t _writeStr(const char* str, uint32_t len, int wpipe);
   uint32_t _writeStr(const char* str, uint32_t len) { return _writeStr(str, len, m_writepipe[1]); }
   uint32_t _writeStr(std::string_view view) { return _writeStr(view.data(), view.size()); }
   std::size_t _readBuf(void* buf, std::size_t len);
   std::size_t _writeBuf(const void* buf, std::size_t len);
-  std::string _readStdString() {
+  template<typename Alloc>
+  void _readString(std::basic_string<char, std::char_traits<char>, Alloc>& str) {
     uint32_t bufSz;
     _readBuf(&bufSz, 4);
-    std::string ret(bufSz, ' ');
-    _readBuf(&ret[0], bufSz);
+    str.resize(bufSz);
+    _readBuf(str.data(), bufSz);
+  }
+  std::string _readStdString() {
+    std::string ret;
+    _readString(ret);
     return ret;
   }
   template<typename T, std::enable_if_t<std::disjunction_v<std::is_arithmetic<T>, std::is_enum<T>>, int> = 0>
   void _readValue(T& v) { _readBuf(&v, sizeof(T)); }
+
+  /** Typed bulk-array frame header; written by hecl.arrayframe on the blender side */
+  struct ArrayFrameHeader {
+    uint32_t count;
+    uint8_t type;
+    uint8_t width;
+    uint16_t reserved;
+  };
+  template<typename T>
+  static constexpr char ArrayFrameType() {
+    if constexpr (std::is_enum_v<T>)
+      return ArrayFrameType<std::underlying_type_t<T>>();
+    else if constexpr (std::is_floating_point_v<T>)
+      return sizeof(T) == 4 ? 'f' : 'd';
+    else if constexpr (std::is_signed_v<T>)
+      return sizeof(T) == 1 ? 'b' : sizeof(T) == 2 ? 'h' : sizeof(T) == 4 ? 'i' : 'q';
+    else
+      return sizeof(T) == 1 ? 'B' : sizeof(T) == 2 ? 'H' : sizeof(T) == 4 ? 'I' : 'Q';
+  }
+  template<typename T, typename = void>
+  struct IsFloatTuple : std::false_type {};
+  template<typename T>
+  struct IsFloatTuple<T, std::void_t<decltype(T::FrameWidth)>> : std::true_type {};
+  template<typename T>
+  struct IsString : std::false_type {};
+  template<typename Alloc>
+  struct IsString<std::basic_string<char, std::char_traits<char>, Alloc>> : std::true_type {};
+  uint32_t _readArrayFrame(char type, uint8_t width);
   template<typename T>
   void _readItems(T enumerator) {
     uint32_t nItems;
@@ -754,9 +1043,12 @@ class Connection {
     for (uint32_t i = 0; i < nItems; ++i)
       enumerator(*this);
   }
-  template<typename T, typename... Args, std::enable_if_t<
-      !std::disjunction_v<std::is_arithmetic<T>, std::is_enum<T>, std::is_same<T, std::string>>, int> = 0>
-  void _readVector(std::vector<T>& container, Args&&... args) {
+  /* Reused across frames so float-tuple decode does not allocate per call */
+  std::vector<float> m_floatScratch;
+  template<typename T, typename Alloc, typename... Args, std::enable_if_t<
+      !std::disjunction_v<std::is_arithmetic<T>, std::is_enum<T>, IsString<T>, IsFloatTuple<T>>,
+      int> = 0>
+  void _readVector(std::vector<T, Alloc>& container, Args&&... args) {
     uint32_t nItems;
     _readBuf(&nItems, 4);
     container.clear();
@@ -764,27 +1056,37 @@ class Connection {
     for (uint32_t i = 0; i < nItems; ++i)
       container.emplace_back(*this, std::forward<Args>(args)...);
   }
-  template<typename T, std::enable_if_t<std::disjunction_v<std::is_arithmetic<T>, std::is_enum<T>>, int> = 0>
-  void _readVector(std::vector<T>& container) {
-    uint32_t nItems;
-    _readBuf(&nItems, 4);
+  template<typename T, typename Alloc, std::enable_if_t<std::disjunction_v<std::is_arithmetic<T>, std::is_enum<T>>, int> = 0>
+  void _readVector(std::vector<T, Alloc>& container) {
+    const uint32_t nItems = _readArrayFrame(ArrayFrameType<T>(), 1);
     container.clear();
     container.resize(nItems);
-    _readBuf(&container[0], sizeof(T) * nItems);
+    if (nItems)
+      _readBuf(container.data(), sizeof(T) * nItems);
   }
-  void _readVector(std::vector<std::string>& container) {
+  template<typename T, typename Alloc, std::enable_if_t<IsFloatTuple<T>::value, int> = 0>
+  void _readVector(std::vector<T, Alloc>& container) {
+    const uint32_t nItems = _readArrayFrame('f', T::FrameWidth);
+    m_floatScratch.resize(std::size_t(nItems) * T::FrameWidth);
+    if (nItems)
+      _readBuf(m_floatScratch.data(), sizeof(float) * m_floatScratch.size());
+    container.clear();
+    container.reserve(nItems);
+    for (uint32_t i = 0; i < nItems; ++i)
+      std::memcpy(static_cast<void*>(&container.emplace_back().val), &m_floatScratch[std::size_t(i) * T::FrameWidth],
+                  sizeof(float) * T::FrameWidth);
+  }
+  template<typename CharAlloc, typename Alloc>
+  void _readVector(std::vector<std::basic_string<char, std::char_traits<char>, CharAlloc>, Alloc>& container) {
     uint32_t nItems;
     _readBuf(&nItems, 4);
     container.clear();
     container.reserve(nItems);
-    for (uint32_t i = 0; i < nItems; ++i) {
-      uint32_t strSize;
-      _readBuf(&strSize, 4);
-      _readBuf(&container.emplace_back(strSize, ' ')[0], strSize);
-    }
+    for (uint32_t i = 0; i < nItems; ++i)
+      _readString(container.emplace_back());
   }
-  template<typename T, typename F>
-  void _readVectorFunc(std::vector<T>& container, F func) {
+  template<typename T, typename Alloc, typename F>
+  void _readVectorFunc(std::vector<T, Alloc>& container, F func) {
     uint32_t nItems;
     _readBuf(&nItems, 4);
     container.clear();
@@ -804,7 +1106,7 @@ class Connection {
   void _checkStatus(std::string_view action, std::string_view status) {
     char readBuf[16];
     _readStr(readBuf, 16);
-    if (status != readBuf)
+    if (status != readBuf && !m_died)
       BlenderLog.report(logvisor::Fatal, FMT_STRING("{}: {}: {}"), m_loadedBlend.getRelativePathUTF8(), action, readBuf);
   }
   void _checkReady(std::string_view action) { _checkStatus(action, "READY"sv); }
@@ -813,6 +1115,7 @@ class Connection {
   void _checkAnimReady(std::string_view action) { _checkStatus(action, "ANIMREADY"sv); }
   void _checkAnimDone(std::string_view action) { _checkStatus(action, "ANIMDONE"sv); }
   void _closePipe();
+  std::string _waitForExit();
   void _blenderDied();
 
 public:
@@ -828,6 +1131,33 @@ public:
   BlendType getBlendType() const { return m_loadedType; }
   const ProjectPath& getBlendPath() const { return m_loadedBlend; }
   bool getRigged() const { return m_loadedRigged; }
+
+  /** When recoverable, a blender crash poisons this connection instead of aborting the process.
+   *  Reads then return zeroes, writes are dropped and isDead() reports the failure. */
+  void setRecoverable(bool recoverable) { m_recoverable = recoverable; }
+  bool isDead() const { return m_died; }
+
+  void setRecyclePolicy(const RecyclePolicy& policy) { m_recyclePolicy = policy; }
+  const RecyclePolicy& getRecyclePolicy() const { return m_recyclePolicy; }
+  /** Threads a mesh compile may use to build its surfaces; 0 allows one per CPU */
+  void setMeshThreads(unsigned threads) { m_meshThreads = threads; }
+  unsigned getMeshThreads() const { return m_meshThreads; }
+  /** Number of blends opened or created by this blender instance */
+  uint32_t getOpenedBlendCount() const { return m_openedBlends; }
+  /** Resident set size of the blender process, or 0 where it cannot be queried */
+  uint64_t getResidentBytes() const;
+  std::chrono::steady_clock::duration getIdleDuration() const { return std::chrono::steady_clock::now() - m_lastPipeIo; }
+  /** Reason the recycle policy wants this instance restarted, or an empty string */
+  std::string recycleReason() const;
+  /** Per-command protocol counters gathered since the connection started */
+  const std::unordered_map<std::string, CommandStats>& getCommandStats();
+  void resetCommandStats();
+  /** Pull blender-side execution times into the command stats (no stream may be active) */
+  void fetchBlenderProfile();
+  void dumpCommandStats();
+
+  /** Wall time from construction until blender reported READY */
+  std::chrono::steady_clock::duration getStartupDuration() const { return m_startupDuration; }
   bool openBlend(const ProjectPath& path, bool force = false);
   bool saveBlend();
   void deleteBlend();
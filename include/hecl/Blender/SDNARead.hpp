@@ -1,6 +1,14 @@
 #pragma once
 
+#include <cstddef>
+#include <cstdint>
 #include <functional>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <unordered_map>
 #include <vector>
 
 #include "hecl/FourCC.hpp"
@@ -12,6 +20,10 @@ namespace athena::io {
 class MemoryReader;
 }
 
+namespace hecl {
+class ProjectPath;
+}
+
 namespace hecl::blender {
 enum class BlendType;
 
@@ -31,6 +43,13 @@ struct SDNABlock : public athena::io::DNA<athena::Endian::Little> {
   Align<4> align3;
   DNAFourCC strcMagic;
   Value<atUint32> numStrcs;
+
+  /* Open-addressed name index slot; idx is UINT32_MAX when empty */
+  struct NameSlot {
+    uint32_t hash = 0;
+    uint32_t idx = UINT32_MAX;
+  };
+
   struct SDNAStruct : public athena::io::DNA<athena::Endian::Little> {
     AT_DECL_DNA
     Value<atUint16> type;
@@ -42,13 +61,25 @@ struct SDNABlock : public athena::io::DNA<athena::Endian::Little> {
       atUint32 offset;
     };
     Vector<SDNAField, AT_DNA_COUNT(numFields)> fields;
+    std::vector<NameSlot> fieldIndex; /* Keyed on field name without array dimensions */
 
     void computeOffsets(const SDNABlock& block);
-    const SDNAField* lookupField(const SDNABlock& block, const char* n) const;
+    const SDNAField* lookupField(const SDNABlock& block, std::string_view n) const;
   };
   Vector<SDNAStruct, AT_DNA_COUNT(numStrcs)> strcs;
+  std::vector<NameSlot> structIndex;
+
+  /** Computes field offsets and builds the name indexes; call once after reading */
+  void buildIndexes();
+  const SDNAStruct* lookupStruct(std::string_view n, atUint32& idx) const;
 
-  const SDNAStruct* lookupStruct(const char* n, atUint32& idx) const;
+  struct FieldRef {
+    atUint32 sdnaIdx = UINT32_MAX;
+    atUint32 offset = 0;
+    explicit operator bool() const { return sdnaIdx != UINT32_MAX; }
+  };
+  /** Resolves a struct's field through the name indexes; does not allocate and is safe to share across threads */
+  FieldRef resolveField(std::string_view strct, std::string_view field) const;
 };
 
 struct FileBlock : public athena::io::DNA<athena::Endian::Little> {
@@ -61,16 +92,117 @@ struct FileBlock : public athena::io::DNA<athena::Endian::Little> {
 };
 
 class SDNARead {
-  std::vector<uint8_t> m_data;
+public:
+  struct BlockEntry {
+    FileBlock header;
+    size_t offset; /* Body offset within the resident data, or NotResident */
+  };
+  static constexpr size_t NotResident = SIZE_MAX;
+  /** Selects the bodies kept resident; DNA1 is always kept and only seekable zstd blends drop the rest */
+  using BlockFilter = std::function<bool(const FileBlock& block)>;
+  static constexpr char ZstdMagic[4] = {'\x28', '\xB5', '\x2F', '\xFD'};
+
+private:
+  /* Read-only mapping of the file, the decompressed copy for gzip/zstd blends,
+   * or the kept bodies of a seekable zstd blend (m_size is then the decompressed size) */
+  const uint8_t* m_data = nullptr;
+  size_t m_size = 0;
+  void* m_map = nullptr;
+  size_t m_mapSize = 0;
+  std::unique_ptr<uint8_t[]> m_inflated;
+  std::vector<uint8_t> m_resident;
+  std::vector<BlockEntry> m_blocks;
   SDNABlock m_sdnaBlock;
 
+  bool mapFile(SystemStringView path);
+  void unmapFile();
+  bool inflateGzip();
+#if HECL_HAS_ZSTD
+  bool indexSeekable(const BlockFilter& keep);
+  bool decompressZstd();
+#endif
+  void indexBlocks();
+
 public:
-  explicit SDNARead(SystemStringView path);
-  explicit operator bool() const { return !m_data.empty(); }
+  explicit SDNARead(SystemStringView path, const BlockFilter& keep = {});
+  ~SDNARead();
+  SDNARead(const SDNARead&) = delete;
+  SDNARead& operator=(const SDNARead&) = delete;
+  explicit operator bool() const { return m_size != 0; }
   const SDNABlock& sdnaBlock() const { return m_sdnaBlock; }
+  const std::vector<BlockEntry>& blocks() const { return m_blocks; }
+  /** Null when the block's body was not kept resident */
+  const uint8_t* blockData(const BlockEntry& block) const {
+    return block.offset == NotResident ? nullptr : m_data + block.offset;
+  }
   void enumerate(const std::function<bool(const FileBlock& block, athena::io::MemoryReader& r)>& func) const;
 };
 
 BlendType GetBlendType(SystemStringView path);
 
+struct BlendDependency {
+  enum class Kind { Library, Image };
+  Kind kind;
+  std::string name; /* Datablock name without its ID code */
+  std::string path; /* As stored; a leading '//' is relative to the blend's directory */
+};
+
+/** Linked libraries and external (unpacked, local) images read straight from the blend's DNA */
+std::vector<BlendDependency> GetBlendDependencies(SystemStringView path);
+
+/** Absolute path of a dependency with '//' resolved against the referencing blend and '.' and '..'
+ *  collapsed; empty when the stored path is relative or climbs above the filesystem root */
+SystemString ResolveBlendDependency(SystemStringView blendPath, const BlendDependency& dep);
+
+/** Dependencies resolved to project paths; files outside the project are skipped */
+std::vector<ProjectPath> GetBlendDependencies(const ProjectPath& path);
+
+/** Per-project blend classification remembered across runs in .hecl/blendtypes.
+ *  Entries are keyed by project-relative path and trusted while the blend's
+ *  file ID, size and mtime are unchanged. mtime is compared at nanosecond
+ *  resolution on Linux and macOS, 100ns on Windows and whole seconds elsewhere,
+ *  so a same-size rewrite within that window goes unnoticed. External images
+ *  referenced by blends are recorded as BlendType::None to keep their content hash. */
+class BlendTypeCache {
+public:
+  struct Entry {
+    BlendType type;
+    std::optional<bool> rigged; /* Unknown when classified without opening blender */
+    uint64_t hash = 0;          /* Content hash of the file alone, if computed by the reply cache */
+  };
+
+private:
+  struct Identity {
+    uint64_t inode = 0;
+    uint64_t size = 0;
+    int64_t mtime = 0;
+    bool operator==(const Identity& other) const {
+      return inode == other.inode && size == other.size && mtime == other.mtime;
+    }
+  };
+  struct Record {
+    Identity id;
+    Entry entry;
+  };
+
+  SystemString m_filePath;
+  std::mutex m_lock;
+  bool m_loaded = false;
+  size_t m_logRecords = 0;
+  std::unordered_map<std::string, Record> m_records;
+
+  static bool StatIdentity(const ProjectPath& path, Identity& id);
+  void load();
+  void compact();
+
+public:
+  explicit BlendTypeCache(SystemString filePath) : m_filePath(std::move(filePath)) {}
+  static BlendTypeCache& ForProject(const ProjectPath& path);
+  std::optional<Entry> lookup(const ProjectPath& path);
+  void store(const ProjectPath& path, const Entry& entry);
+};
+
+/** Classifies through the project's BlendTypeCache, scanning the blend only on a miss */
+BlendType GetBlendType(const ProjectPath& path);
+
 } // namespace hecl::blender
@@ -1,17 +1,46 @@
 #pragma once
 
+#include <chrono>
+#include <cstdint>
 #include <memory>
 
 namespace hecl::blender {
 class Connection;
 
+/** Limits after which a long-lived blender instance is restarted between transactions; zero disables each limit */
+struct RecyclePolicy {
+  uint32_t maxBlends = 0;
+  uint64_t maxResidentBytes = 0;
+  std::chrono::seconds idleTimeout{0};
+
+  /** Reads HECL_BLENDER_RECYCLE_BLENDS, HECL_BLENDER_RECYCLE_RSS_MB and HECL_BLENDER_RECYCLE_IDLE_SECS */
+  static RecyclePolicy FromEnvironment();
+};
+
 class Token {
   std::unique_ptr<Connection> m_conn;
+  bool m_recoverable = false;
+  RecyclePolicy m_recyclePolicy = RecyclePolicy::FromEnvironment();
+  unsigned m_meshThreads = 0;
 
 public:
   Connection& getBlenderConnection();
   void shutdown();
 
+  /** Survive blender crashes; applies to connections spawned after this call */
+  void setRecoverable(bool recoverable) { m_recoverable = recoverable; }
+  bool blenderDied() const;
+  /** Discard a crashed connection so the next getBlenderConnection() respawns blender */
+  bool recoverDiedConnection();
+
+  /** Threads a mesh compile may use to build its surfaces; 0 allows one per CPU */
+  void setMeshThreads(unsigned threads);
+  void setRecyclePolicy(const RecyclePolicy& policy);
+  const RecyclePolicy& getRecyclePolicy() const { return m_recyclePolicy; }
+  bool hasBlenderConnection() const { return bool(m_conn); }
+  /** Shut blender down if the policy says it is due; the next getBlenderConnection() starts a fresh one */
+  bool recycleIfNeeded();
+
   Token() = default;
   ~Token();
   Token(const Token&) = delete;
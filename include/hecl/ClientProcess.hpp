@@ -32,6 +32,7 @@ class ClientProcess {
   const MultiProgressPrinter* m_progPrinter;
   int m_completedCooks = 0;
   int m_addedCooks = 0;
+  int m_failedCooks = 0;
 
 public:
   struct Transaction {
@@ -54,9 +55,11 @@ public:
     ProjectPath m_path;
     Database::IDataSpec* m_dataSpec;
     bool m_returnResult = false;
+    bool m_failed = false; /**< Blender crashed on every attempt */
     bool m_force;
     bool m_fast;
     void run(blender::Token& btok) override;
+    bool failed() const { return m_failed; }
     CookTransaction(ClientProcess& parent, const ProjectPath& path, bool force, bool fast, Database::IDataSpec* spec)
     : Transaction(parent, Type::Cook), m_path(path), m_dataSpec(spec), m_force(force), m_fast(fast) {}
   };
@@ -72,6 +75,7 @@ private:
   std::list<std::shared_ptr<Transaction>> m_completedQueue;
   int m_inProgress = 0;
   bool m_running = true;
+  unsigned m_meshThreads = 1; /* CPU share of each worker's mesh compiles */
 
   struct Worker {
     ClientProcess& m_proc;
@@ -95,7 +99,10 @@ public:
   std::shared_ptr<const LambdaTransaction> addLambdaTransaction(std::function<void(blender::Token&)>&& func);
   bool syncCook(const hecl::ProjectPath& path, Database::IDataSpec* spec, blender::Token& btok, bool force, bool fast);
   void swapCompletedQueue(std::list<std::shared_ptr<Transaction>>& queue);
+  /** Blocks until every queued transaction has run, reporting cooks that blender could not complete */
   void waitUntilComplete();
+  /** Cooks given up on after blender crashed on every attempt */
+  int failedCookCount() const { return m_failedCooks; }
   void shutdown();
   bool isBusy() const { return m_pendingQueue.size() || m_inProgress; }
 
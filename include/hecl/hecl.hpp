@@ -251,6 +251,10 @@ inline bool IsAbsolute(SystemStringView path) {
 
 const SystemChar* GetTmpDir();
 
+/** Returns a ".<pid>.<counter>" suffix unique to this call within the process and
+ *  across concurrently running processes, for staging temporary files before Rename */
+SystemString TempFileSuffix();
+
 #if !WINDOWS_STORE
 int RunProcess(const SystemChar* path, const SystemChar* const args[]);
 #endif
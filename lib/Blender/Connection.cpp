@@ -14,6 +14,7 @@
 #include <tuple>
 
 #include "hecl/Blender/Connection.hpp"
+#include "hecl/Blender/SDNARead.hpp"
 #include "hecl/Blender/Token.hpp"
 #include "hecl/Database.hpp"
 #include "hecl/hecl.hpp"
@@ -26,9 +27,18 @@
 #if _WIN32
 #include <io.h>
 #include <fcntl.h>
+#include <psapi.h>
 #else
+#include <poll.h>
 #include <sys/wait.h>
 #endif
+#if __linux__
+#include <sys/syscall.h>
+#endif
+#if __APPLE__
+#include <libproc.h>
+#include <sys/event.h>
+#endif
 
 #undef min
 #undef max
@@ -68,11 +78,8 @@ extern "C" size_t HECL_BLENDERSHELL_SZ;
 extern "C" uint8_t HECL_ADDON[];
 extern "C" size_t HECL_ADDON_SZ;
 
-extern "C" uint8_t HECL_STARTUP[];
-extern "C" size_t HECL_STARTUP_SZ;
-
 static void InstallBlendershell(const SystemChar* path) {
-  auto fp = hecl::FopenUnique(path, _SYS_STR("w"));
+  auto fp = hecl::FopenUnique(path, _SYS_STR("wb"));
 
   if (fp == nullptr) {
     BlenderLog.report(logvisor::Fatal, FMT_STRING(_SYS_STR("unable to open {} for writing")), path);
@@ -91,6 +98,70 @@ static void InstallAddon(const SystemChar* path) {
   std::fwrite(HECL_ADDON, 1, HECL_ADDON_SZ, fp.get());
 }
 
+/* Content stamp of the embedded shell and addon. The BLENDER_BIN override is folded in since
+ * each blender install keeps its own user addon directory. */
+static std::string AddonStamp() {
+  uint64_t hash = XXH64(HECL_BLENDERSHELL, HECL_BLENDERSHELL_SZ, 0);
+  hash = XXH64(HECL_ADDON, HECL_ADDON_SZ, hash);
+#if _WIN32
+  if (const wchar_t* blenderBin = _wgetenv(L"BLENDER_BIN"))
+    hash = XXH64(blenderBin, wcslen(blenderBin) * sizeof(wchar_t), hash);
+#else
+  if (const char* blenderBin = getenv("BLENDER_BIN"))
+    hash = XXH64(blenderBin, strlen(blenderBin), hash);
+#endif
+  return fmt::format(FMT_STRING("{:016X}"), hash);
+}
+
+static bool CheckAddonStamp(const SystemChar* stampPath, const SystemChar* shellPath, std::string_view stamp) {
+  /* The installed shell lives in the shared temp dir, so its content is checked rather than trusted */
+  {
+    auto fp = hecl::FopenUnique(shellPath, _SYS_STR("rb"));
+    if (fp == nullptr)
+      return false;
+    std::vector<uint8_t> shell(HECL_BLENDERSHELL_SZ + 1);
+    if (std::fread(shell.data(), 1, shell.size(), fp.get()) != HECL_BLENDERSHELL_SZ ||
+        XXH64(shell.data(), HECL_BLENDERSHELL_SZ, 0) != XXH64(HECL_BLENDERSHELL, HECL_BLENDERSHELL_SZ, 0))
+      return false;
+  }
+
+  auto fp = hecl::FopenUnique(stampPath, _SYS_STR("rb"));
+  if (fp == nullptr)
+    return false;
+
+  char buf[16];
+  return std::fread(buf, 1, sizeof(buf), fp.get()) == stamp.size() && stamp == std::string_view(buf, sizeof(buf));
+}
+
+static void WriteAddonStamp(const SystemChar* stampPath, std::string_view stamp) {
+  auto fp = hecl::FopenUnique(stampPath, _SYS_STR("wb"));
+  if (fp == nullptr) {
+    BlenderLog.report(logvisor::Warning, FMT_STRING(_SYS_STR("unable to write addon stamp '{}'")), stampPath);
+    return;
+  }
+
+  std::fwrite(stamp.data(), 1, stamp.size(), fp.get());
+}
+
+/* Optional pre-initialised startup .blend loaded in place of the user's startup file */
+static hecl::SystemString StartupBlend() {
+#if _WIN32
+  const wchar_t* startupPath = _wgetenv(L"HECL_BLENDER_STARTUP");
+#else
+  const char* startupPath = getenv("HECL_BLENDER_STARTUP");
+#endif
+  if (!startupPath || !startupPath[0])
+    return {};
+
+  hecl::Sstat theStat;
+  if (hecl::Stat(startupPath, &theStat) || !S_ISREG(theStat.st_mode)) {
+    BlenderLog.report(logvisor::Warning, FMT_STRING(_SYS_STR("ignoring missing startup blend '{}'")), startupPath);
+    return {};
+  }
+
+  return startupPath;
+}
+
 static int Read(int fd, void* buf, std::size_t size) {
   int intrCount = 0;
   do {
@@ -121,6 +192,42 @@ static int Write(int fd, const void* buf, std::size_t size) {
   return -1;
 }
 
+/* Session recording written when HECL_BLENDER_RECORD names a file.
+ * Layout: 'HBRC' magic, u32 version, then chunks of {u8 direction, u32 length, payload}.
+ * Direction '>' is data written to blender, '<' is data read back from it.
+ * hecl-blender-replay consumes the same layout (keep both in sync). */
+constexpr std::array<char, 4> RecordMagic{'H', 'B', 'R', 'C'};
+constexpr uint32_t RecordVersion = 1;
+
+static hecl::UniqueFilePtr OpenRecording() {
+#if _WIN32
+  const wchar_t* recordPath = _wgetenv(L"HECL_BLENDER_RECORD");
+#else
+  const char* recordPath = getenv("HECL_BLENDER_RECORD");
+#endif
+  if (!recordPath || !recordPath[0])
+    return {};
+
+  auto fp = hecl::FopenUnique(recordPath, _SYS_STR("wb"));
+  if (fp == nullptr) {
+    BlenderLog.report(logvisor::Error, FMT_STRING(_SYS_STR("unable to open '{}' for recording")), recordPath);
+    return {};
+  }
+
+  std::fwrite(RecordMagic.data(), 1, RecordMagic.size(), fp.get());
+  std::fwrite(&RecordVersion, 1, sizeof(RecordVersion), fp.get());
+  return fp;
+}
+
+void Connection::_recordChunk(char direction, const void* buf, std::size_t len) {
+  if (!m_recordFile || !len || (m_replaying && direction == '<'))
+    return;
+  const auto len32 = static_cast<uint32_t>(len);
+  std::fwrite(&direction, 1, 1, m_recordFile.get());
+  std::fwrite(&len32, 1, sizeof(len32), m_recordFile.get());
+  std::fwrite(buf, 1, len, m_recordFile.get());
+}
+
 static std::size_t BoundedStrLen(const char* buf, std::size_t maxLen) {
   std::size_t ret;
   for (ret = 0; ret < maxLen; ++ret)
@@ -129,11 +236,263 @@ static std::size_t BoundedStrLen(const char* buf, std::size_t maxLen) {
   return ret;
 }
 
+int Connection::_pipeRead(void* buf, std::size_t len) {
+  if (m_replaying) {
+    const std::size_t count = std::min(len, m_replyBuf.size() - m_replyPos);
+    std::memcpy(buf, m_replyBuf.data() + m_replyPos, count);
+    m_replyPos += count;
+    m_curStats->bytesIn += count;
+    return int(count);
+  }
+
+  const auto start = std::chrono::steady_clock::now();
+  const int ret = Read(m_readpipe[0], buf, len);
+  m_lastPipeIo = std::chrono::steady_clock::now();
+  m_curStats->readBlocked += m_lastPipeIo - start;
+  ++m_curStats->readCalls;
+  if (ret > 0) {
+    m_curStats->bytesIn += ret;
+    if (m_capturing)
+      m_replyBuf.insert(m_replyBuf.end(), static_cast<uint8_t*>(buf), static_cast<uint8_t*>(buf) + ret);
+  }
+  return ret;
+}
+
+bool Connection::_replyAvailable(std::chrono::milliseconds timeout) const {
+  if (m_died)
+    return true;
+#if _WIN32
+  const HANDLE pipe = HANDLE(_get_osfhandle(m_readpipe[0]));
+  const auto deadline = std::chrono::steady_clock::now() + timeout;
+  for (;;) {
+    DWORD avail = 0;
+    if (!PeekNamedPipe(pipe, nullptr, 0, nullptr, &avail, nullptr) || avail)
+      return true;
+    if (std::chrono::steady_clock::now() >= deadline)
+      return false;
+    Sleep(1);
+  }
+#else
+  pollfd pfd{m_readpipe[0], POLLIN, 0};
+  int ret;
+  while ((ret = poll(&pfd, 1, int(timeout.count()))) < 0 && errno == EINTR) {}
+  /* Errors and hangups are surfaced by the next read */
+  return ret != 0;
+#endif
+}
+
+int Connection::_pipeWrite(const void* buf, std::size_t len) {
+  const auto start = std::chrono::steady_clock::now();
+  const int ret = Write(m_writepipe[1], buf, len);
+  m_lastPipeIo = std::chrono::steady_clock::now();
+  m_curStats->writeBlocked += m_lastPipeIo - start;
+  ++m_curStats->writeCalls;
+  if (ret > 0)
+    m_curStats->bytesOut += ret;
+  return ret;
+}
+
+void Connection::_finishCommandStats() {
+  if (m_lastPipeIo <= m_curCommandStart)
+    return;
+  const auto wall = m_lastPipeIo - m_curCommandStart;
+  m_curStats->wallTime += wall;
+  const auto us = uint64_t(std::chrono::duration_cast<std::chrono::microseconds>(wall).count());
+  std::size_t bucket = 0;
+  while (bucket + 1 < m_curStats->wallHistogram.size() && (us >> (bucket + 1)) != 0)
+    ++bucket;
+  ++m_curStats->wallHistogram[bucket];
+  m_curCommandStart = m_lastPipeIo;
+}
+
+void Connection::_beginCommandStats(CommandStats* stats) {
+  _finishCommandStats();
+  m_curStats = stats;
+  m_curCommandStart = m_lastPipeIo = std::chrono::steady_clock::now();
+}
+
+void Connection::_writeCommand(std::string_view cmd, bool pipelined) {
+  bool capture = false;
+  if (m_cacheNext) {
+    m_cacheNext = false;
+    m_cacheKey = _cacheKey(cmd);
+    if (auto entry = _loadCacheEntry(m_cacheKey)) {
+      CommandStats* stats = &m_commandStats["CACHEHIT"];
+      ++stats->count;
+      _beginCommandStats(stats);
+      m_replyBuf = std::move(*entry);
+      m_replyPos = 0;
+      m_replaying = true;
+      return;
+    }
+    capture = true;
+  }
+
+  /* GETPROFILE doesn't depend on the loaded blend, so it must not force a deferred OPEN */
+  if ((m_openDeferred || m_dataDeferred) && cmd != "GETPROFILE")
+    _resumeDeferred();
+
+  CommandStats* stats = &m_commandStats[std::string(cmd.substr(0, cmd.find(' ')))];
+  ++stats->count;
+  _beginCommandStats(stats);
+  /* The shell holds a pipelined command's reply until it is complete; see Pipeline::replyReady */
+  if (pipelined)
+    _writeStr(fmt::format(FMT_STRING("PIPELINED {}"), cmd));
+  else
+    _writeStr(cmd);
+
+  if (capture) {
+    m_replyBuf.clear();
+    m_capturing = true;
+  }
+}
+
+/* Folded into every cache key so replies produced by a different addon are never reused */
+static uint64_t CacheSalt() {
+  static const uint64_t Salt = XXH64(AddonStamp().data(), AddonStamp().size(), 0);
+  return Salt;
+}
+
+static uint64_t HashFile(SystemStringView path) {
+  auto fp = hecl::FopenUnique(path.data(), _SYS_STR("rb"));
+  if (fp == nullptr)
+    return 0;
+  std::vector<uint8_t> buf(1024 * 1024);
+  uint64_t hash = CacheSalt();
+  std::size_t readLen;
+  while ((readLen = std::fread(buf.data(), 1, buf.size(), fp.get())))
+    hash = XXH64(buf.data(), readLen, hash);
+  /* Zero is reserved for uncacheable blends */
+  return hash ? hash : 1;
+}
+
+/* Project files keep their content hash in the BlendTypeCache under the same inode/size/mtime
+ * identity as their classification, so unchanged dependencies aren't re-read on every open */
+static uint64_t CachedFileHash(const ProjectPath& path, bool isBlend) {
+  BlendTypeCache& cache = BlendTypeCache::ForProject(path);
+  auto entry = cache.lookup(path);
+  if (entry && entry->hash)
+    return entry->hash;
+  const uint64_t hash = HashFile(path.getAbsolutePath());
+  if (!hash)
+    return 0;
+  if (!entry) {
+    const BlendType type = isBlend ? GetBlendType(path) : BlendType::None;
+    entry = BlendTypeCache::Entry{type, type == BlendType::Mesh ? std::nullopt : std::optional<bool>(false), 0};
+  }
+  entry->hash = hash;
+  cache.store(path, *entry);
+  return hash;
+}
+
+/* Linked libraries (recursively) and external images feed the cooked output, so their content is
+ * folded into the blend's key. A library that can't be read makes the blend uncacheable (0); a
+ * missing image folds its path instead, so the key changes once the image appears. */
+static uint64_t FoldDependencyHashes(Database::Project& project, const SystemString& blendPath, uint64_t hash,
+                                     std::vector<SystemString>& visited) {
+  const SystemString projRoot(project.getProjectRootPath().getAbsolutePath());
+  for (const BlendDependency& dep : GetBlendDependencies(blendPath)) {
+    const SystemString depPath = ResolveBlendDependency(blendPath, dep);
+    if (depPath.empty() || std::find(visited.cbegin(), visited.cend(), depPath) != visited.cend())
+      continue;
+    visited.push_back(depPath);
+
+    const bool isLibrary = dep.kind == BlendDependency::Kind::Library;
+    uint64_t depHash;
+    if (!depPath.compare(0, projRoot.size(), projRoot) && depPath.size() > projRoot.size() + 1 &&
+        depPath[projRoot.size()] == _SYS_STR('/'))
+      depHash = CachedFileHash(ProjectPath(project, SystemStringView(depPath).substr(projRoot.size() + 1)), isLibrary);
+    else
+      depHash = HashFile(depPath);
+    if (!depHash) {
+      if (isLibrary)
+        return 0;
+      depHash = XXH64(depPath.data(), depPath.size() * sizeof(SystemChar), 0);
+    }
+    hash = XXH64(&depHash, sizeof(depHash), hash);
+    if (isLibrary) {
+      hash = FoldDependencyHashes(project, depPath, hash, visited);
+      if (!hash)
+        return 0;
+    }
+  }
+  return hash ? hash : 1;
+}
+
+std::string Connection::_cacheKey(std::string_view cmd) const {
+  return fmt::format(FMT_STRING("{:016X}-{:016X}"), m_blendHash, XXH64(cmd.data(), cmd.size(), CacheSalt()));
+}
+
+std::optional<std::vector<uint8_t>> Connection::_loadCacheEntry(std::string_view key) const {
+  const hecl::SystemString entryPath = m_cacheDir + _SYS_STR('/') + hecl::SystemString(hecl::SystemStringConv(key).sys_str());
+  auto fp = hecl::FopenUnique(entryPath.c_str(), _SYS_STR("rb"));
+  if (fp == nullptr)
+    return std::nullopt;
+  hecl::FSeek(fp.get(), 0, SEEK_END);
+  std::vector<uint8_t> data(hecl::FTell(fp.get()));
+  hecl::FSeek(fp.get(), 0, SEEK_SET);
+  if (std::fread(data.data(), 1, data.size(), fp.get()) != data.size())
+    return std::nullopt;
+  return {std::move(data)};
+}
+
+void Connection::_storeCacheEntry(std::string_view key, const std::vector<uint8_t>& data) const {
+  hecl::MakeDir(m_cacheDir.c_str());
+  const hecl::SystemString entryPath = m_cacheDir + _SYS_STR('/') + hecl::SystemString(hecl::SystemStringConv(key).sys_str());
+  /* Written aside and renamed so concurrent workers never see a partial entry */
+  const hecl::SystemString tmpPath = entryPath + hecl::TempFileSuffix();
+  {
+    auto fp = hecl::FopenUnique(tmpPath.c_str(), _SYS_STR("wb"));
+    if (fp == nullptr || std::fwrite(data.data(), 1, data.size(), fp.get()) != data.size()) {
+      BlenderLog.report(logvisor::Warning, FMT_STRING(_SYS_STR("unable to write blender cache entry '{}'")), tmpPath);
+      return;
+    }
+  }
+  if (hecl::Rename(tmpPath.c_str(), entryPath.c_str()))
+    hecl::Unlink(tmpPath.c_str());
+}
+
+void Connection::_resumeDeferred() {
+  const bool dataDeferred = m_dataDeferred;
+  m_openDeferred = false;
+  m_dataDeferred = false;
+
+  _writeCommand(fmt::format(FMT_STRING("OPEN \"{}\""), m_loadedBlend.getAbsolutePathUTF8()));
+  ++m_openedBlends;
+  if (!_isFinished())
+    BlenderLog.report(logvisor::Fatal, FMT_STRING(_SYS_STR("unable to open {} with blender")),
+                      m_loadedBlend.getAbsolutePath());
+  _readOpenInfo();
+
+  if (dataDeferred) {
+    _writeCommand("DATABEGIN");
+    _checkReady("unable to open DataStream with blender"sv);
+  }
+}
+
+void Connection::_endCachedReply() {
+  m_cacheNext = false;
+  if (m_replaying) {
+    m_replaying = false;
+    m_replyBuf.clear();
+  } else if (m_capturing) {
+    m_capturing = false;
+    if (!m_died)
+      _storeCacheEntry(m_cacheKey, m_replyBuf);
+    m_replyBuf.clear();
+  }
+}
+
 uint32_t Connection::_readStr(char* buf, uint32_t bufSz) {
+  *buf = '\0';
+  if (m_died)
+    return 0;
+
   uint32_t readLen;
-  int ret = Read(m_readpipe[0], &readLen, sizeof(readLen));
+  int ret = _pipeRead(&readLen, sizeof(readLen));
   if (ret < 4) {
-    BlenderLog.report(logvisor::Error, FMT_STRING("Pipe error {} {}"), ret, strerror(errno));
+    if (ret != 0)
+      BlenderLog.report(logvisor::Error, FMT_STRING("Pipe error {} {}"), ret, strerror(errno));
     _blenderDied();
     return 0;
   }
@@ -144,16 +503,21 @@ uint32_t Connection::_readStr(char* buf, uint32_t bufSz) {
     return 0;
   }
 
-  ret = Read(m_readpipe[0], buf, readLen);
-  if (ret < 0) {
-    BlenderLog.report(logvisor::Fatal, FMT_STRING("{}"), strerror(errno));
+  _recordChunk('<', &readLen, sizeof(readLen));
+
+  ret = _pipeRead(buf, readLen);
+  if (ret < 0 || (ret == 0 && readLen != 0)) {
+    *buf = '\0';
+    _blenderDied();
     return 0;
   }
+  _recordChunk('<', buf, ret);
 
   constexpr std::string_view exception_str{"EXCEPTION"};
   const std::size_t readStrLen = BoundedStrLen(buf, readLen);
   if (readStrLen >= exception_str.size()) {
     if (exception_str.compare(0, exception_str.size(), std::string_view(buf, readStrLen)) == 0) {
+      *buf = '\0';
       _blenderDied();
       return 0;
     }
@@ -169,31 +533,45 @@ uint32_t Connection::_writeStr(const char* buf, uint32_t len, int wpipe) {
     return 0U;
   };
 
-  const int nlerr = Write(wpipe, &len, 4);
+  if (m_died && wpipe == m_writepipe[1])
+    return 0;
+
+  const bool mainPipe = wpipe == m_writepipe[1];
+  const int nlerr = mainPipe ? _pipeWrite(&len, 4) : Write(wpipe, &len, 4);
   if (nlerr < 4) {
     return error();
   }
 
-  const int ret = Write(wpipe, buf, len);
+  const int ret = mainPipe ? _pipeWrite(buf, len) : Write(wpipe, buf, len);
   if (ret < 0) {
     return error();
   }
 
+  if (mainPipe) {
+    _recordChunk('>', &len, 4);
+    _recordChunk('>', buf, ret);
+  }
+
   return static_cast<uint32_t>(ret);
 }
 
 std::size_t Connection::_readBuf(void* buf, std::size_t len) {
-  const auto error = [this] {
+  /* A dead connection yields zeroes so decoders unwind without further reads */
+  const auto error = [this, buf, totalLen = len] {
     _blenderDied();
+    std::memset(buf, 0, totalLen);
     return 0U;
   };
 
+  if (m_died)
+    return error();
+
   auto* cBuf = static_cast<uint8_t*>(buf);
   std::size_t readLen = 0;
 
   do {
-    const int ret = Read(m_readpipe[0], cBuf, len);
-    if (ret < 0) {
+    const int ret = _pipeRead(cBuf, len);
+    if (ret <= 0) {
       return error();
     }
 
@@ -201,10 +579,11 @@ std::size_t Connection::_readBuf(void* buf, std::size_t len) {
     const std::size_t readStrLen = BoundedStrLen(static_cast<char*>(buf), len);
     if (readStrLen >= exception_str.size()) {
       if (exception_str.compare(0, exception_str.size(), std::string_view(static_cast<char*>(buf), readStrLen)) == 0) {
-        _blenderDied();
+        return error();
       }
     }
 
+    _recordChunk('<', cBuf, ret);
     readLen += ret;
     cBuf += ret;
     len -= ret;
@@ -219,15 +598,19 @@ std::size_t Connection::_writeBuf(const void* buf, std::size_t len) {
     return 0U;
   };
 
+  if (m_died)
+    return 0;
+
   const auto* cBuf = static_cast<const uint8_t*>(buf);
   std::size_t writeLen = 0;
 
   do {
-    const int ret = Write(m_writepipe[1], cBuf, len);
+    const int ret = _pipeWrite(cBuf, len);
     if (ret < 0) {
       return error();
     }
 
+    _recordChunk('>', cBuf, ret);
     writeLen += ret;
     cBuf += ret;
     len -= ret;
@@ -236,6 +619,18 @@ std::size_t Connection::_writeBuf(const void* buf, std::size_t len) {
   return writeLen;
 }
 
+uint32_t Connection::_readArrayFrame(char type, uint8_t width) {
+  ArrayFrameHeader header;
+  _readBuf(&header, sizeof(header));
+  /* A dead connection reads as an empty frame so callers fall through to recovery */
+  if (m_died)
+    return 0;
+  if (header.type != uint8_t(type) || header.width != width)
+    BlenderLog.report(logvisor::Fatal, FMT_STRING("expected array frame '{}'x{}, received '{}'x{}"), type, width,
+                      char(header.type), header.width);
+  return header.count;
+}
+
 ProjectPath Connection::_readPath() {
   std::string path = _readStdString();
   if (!path.empty()) {
@@ -250,6 +645,7 @@ ProjectPath Connection::_readPath() {
 void Connection::_closePipe() {
   close(m_readpipe[0]);
   close(m_writepipe[1]);
+  m_recordFile.reset();
 #ifdef _WIN32
   CloseHandle(m_pinfo.hProcess);
   CloseHandle(m_pinfo.hThread);
@@ -259,26 +655,86 @@ void Connection::_closePipe() {
 #endif
 }
 
+std::string Connection::_waitForExit() {
+  /* Give the child up to a second to finish writing its error file and exit */
+#if _WIN32
+  if (WaitForSingleObject(m_pinfo.hProcess, 1000) == WAIT_OBJECT_0) {
+    DWORD exitCode = 0;
+    GetExitCodeProcess(m_pinfo.hProcess, &exitCode);
+    return fmt::format(FMT_STRING("exited with code {:08X}"), exitCode);
+  }
+#else
+  /* Block on an exit notification for the child; the status itself is left for the reaper */
+  bool waited = false;
+#if __linux__ && defined(SYS_pidfd_open)
+  const int pidfd = int(syscall(SYS_pidfd_open, m_blenderProc, 0));
+  if (pidfd >= 0) {
+    pollfd pfd = {pidfd, POLLIN, 0};
+    while (poll(&pfd, 1, 1000) < 0 && errno == EINTR) {}
+    close(pidfd);
+    waited = true;
+  }
+#elif __APPLE__
+  const int kq = kqueue();
+  if (kq >= 0) {
+    struct kevent ev;
+    EV_SET(&ev, m_blenderProc, EVFILT_PROC, EV_ADD | EV_ONESHOT, NOTE_EXIT, 0, nullptr);
+    const timespec timeout = {1, 0};
+    /* Registration fails with ESRCH once the child has already exited */
+    kevent(kq, &ev, 1, &ev, 1, &timeout);
+    close(kq);
+    waited = true;
+  }
+#endif
+  for (int i = 0; i < (waited ? 1 : 200); ++i) {
+    siginfo_t info{};
+    if (waitid(P_PID, id_t(m_blenderProc), &info, WEXITED | WNOHANG | WNOWAIT) == 0 && info.si_pid != 0) {
+      if (info.si_code == CLD_EXITED)
+        return fmt::format(FMT_STRING("exited with status {}"), info.si_status);
+      return fmt::format(FMT_STRING("killed by signal {}"), info.si_status);
+    }
+    /* Kernels without pidfd fall back to polling */
+    if (!waited)
+      std::this_thread::sleep_for(std::chrono::milliseconds(5));
+  }
+#endif
+  return "still running";
+}
+
 void Connection::_blenderDied() {
-  std::this_thread::sleep_for(std::chrono::milliseconds(100));
-  auto errFp = hecl::FopenUnique(m_errPath.c_str(), _SYS_STR("r"));
+  if (m_died)
+    return;
+  m_died = true;
+  const std::string exitStatus = _waitForExit();
 
+  std::string errText;
+  auto errFp = hecl::FopenUnique(m_errPath.c_str(), _SYS_STR("r"));
   if (errFp != nullptr) {
     std::fseek(errFp.get(), 0, SEEK_END);
     const int64_t len = hecl::FTell(errFp.get());
 
-    if (len != 0) {
+    if (len > 0) {
       std::fseek(errFp.get(), 0, SEEK_SET);
-      const auto buf = std::make_unique<char[]>(len + 1);
-      std::fread(buf.get(), 1, len, errFp.get());
-      BlenderLog.report(logvisor::Fatal, FMT_STRING("\n{:.{}s}"), buf.get(), len);
+      errText.resize(len);
+      errText.resize(std::fread(errText.data(), 1, len, errFp.get()));
     }
   }
 
-  BlenderLog.report(logvisor::Fatal, FMT_STRING("Blender Exception"));
+  if (!m_recoverable) {
+    if (!errText.empty())
+      BlenderLog.report(logvisor::Fatal, FMT_STRING("\n{}"), errText);
+    BlenderLog.report(logvisor::Fatal, FMT_STRING("Blender Exception"));
+  }
+
+  /* Leave the connection poisoned; the owning Token respawns blender between transactions */
+  BlenderLog.report(logvisor::Error, FMT_STRING(_SYS_STR("Blender {} while processing '{}'")),
+                    hecl::SystemStringConv(exitStatus).sys_str(), m_loadedBlend.getRelativePath());
+  if (!errText.empty())
+    BlenderLog.report(logvisor::Error, FMT_STRING("\n{}"), errText);
 }
 
 static std::atomic_bool BlenderFirstInit(false);
+static std::atomic_bool AddonStampValid(false);
 
 #if _WIN32
 static bool RegFileExists(const hecl::SystemChar* path) {
@@ -290,7 +746,16 @@ static bool RegFileExists(const hecl::SystemChar* path) {
 #endif
 
 Connection::Connection(int verbosityLevel) {
+  _beginCommandStats(&m_commandStats["STARTUP"]);
+#if _WIN32
+  m_statsDump = _wgetenv(L"HECL_BLENDER_STATS") != nullptr;
+  m_cacheEnabled = _wgetenv(L"HECL_BLENDER_CACHE") != nullptr;
+#else
+  m_statsDump = getenv("HECL_BLENDER_STATS") != nullptr;
+  m_cacheEnabled = getenv("HECL_BLENDER_CACHE") != nullptr;
+#endif
 #if !WINDOWS_STORE
+  const auto startTime = std::chrono::steady_clock::now();
   if (hecl::VerbosityLevel >= 1)
     BlenderLog.report(logvisor::Info, FMT_STRING("Establishing BlenderConnection..."));
 
@@ -303,17 +768,31 @@ Connection::Connection(int verbosityLevel) {
   hecl::SystemString blenderShellPath(TMPDIR);
   blenderShellPath += _SYS_STR("/hecl_blendershell.py");
 
-  hecl::SystemString blenderAddonPath(TMPDIR);
-  blenderAddonPath += _SYS_STR("/hecl_blenderaddon.zip");
+  hecl::SystemString blenderAddonZip(TMPDIR);
+  blenderAddonZip += _SYS_STR("/hecl_blenderaddon.zip");
+
+  hecl::SystemString addonStampPath(TMPDIR);
+  addonStampPath += _SYS_STR("/hecl_blenderaddon.stamp");
+  const std::string addonStamp = AddonStamp();
 
   bool FalseCmp = false;
   if (BlenderFirstInit.compare_exchange_strong(FalseCmp, true)) {
-    InstallBlendershell(blenderShellPath.c_str());
-    InstallAddon(blenderAddonPath.c_str());
+    /* A matching stamp means blender already has this exact addon installed */
+    if (CheckAddonStamp(addonStampPath.c_str(), blenderShellPath.c_str(), addonStamp)) {
+      AddonStampValid = true;
+    } else {
+      InstallBlendershell(blenderShellPath.c_str());
+      InstallAddon(blenderAddonZip.c_str());
+    }
   }
 
+  hecl::SystemString blenderAddonPath = AddonStampValid ? _SYS_STR("SKIPINSTALL") : blenderAddonZip;
+  const hecl::SystemString startupBlend = StartupBlend();
+
   int installAttempt = 0;
+  int launchCount = 0;
   while (true) {
+    ++launchCount;
     /* Construct communication pipes */
 #if _WIN32
     _pipe(m_readpipe.data(), 2048, _O_BINARY);
@@ -391,8 +870,11 @@ Connection::Connection(int verbosityLevel) {
       }
     }
 
-    std::wstring cmdLine = fmt::format(FMT_STRING(L" --background -P \"{}\" -- {} {} {} \"{}\""), blenderShellPath,
-                                       uintptr_t(writehandle), uintptr_t(readhandle), verbosityLevel, blenderAddonPath);
+    std::wstring cmdLine;
+    if (!startupBlend.empty())
+      cmdLine = fmt::format(FMT_STRING(L" \"{}\""), startupBlend);
+    cmdLine += fmt::format(FMT_STRING(L" --background -P \"{}\" -- {} {} {} \"{}\""), blenderShellPath,
+                           uintptr_t(writehandle), uintptr_t(readhandle), verbosityLevel, blenderAddonPath);
 
     STARTUPINFO sinfo = {sizeof(STARTUPINFO)};
     HANDLE nulHandle = CreateFileW(L"nul", GENERIC_WRITE, FILE_SHARE_READ | FILE_SHARE_WRITE, &sattrs, OPEN_EXISTING,
@@ -473,10 +955,20 @@ Connection::Connection(int verbosityLevel) {
       std::string writefds = fmt::format(FMT_STRING("{}"), m_readpipe[1]);
       std::string vLevel = fmt::format(FMT_STRING("{}"), verbosityLevel);
 
+      const auto execBlender = [&](const char* bin) {
+        std::vector<const char*> argv{bin};
+        if (!startupBlend.empty())
+          argv.push_back(startupBlend.c_str());
+        for (const char* arg : {"--background", "-P", blenderShellPath.c_str(), "--", readfds.c_str(),
+                                writefds.c_str(), vLevel.c_str(), blenderAddonPath.c_str()})
+          argv.push_back(arg);
+        argv.push_back(nullptr);
+        execvp(bin, const_cast<char* const*>(argv.data()));
+      };
+
       /* Try user-specified blender first */
       if (blenderBin) {
-        execlp(blenderBin, blenderBin, "--background", "-P", blenderShellPath.c_str(), "--", readfds.c_str(),
-               writefds.c_str(), vLevel.c_str(), blenderAddonPath.c_str(), nullptr);
+        execBlender(blenderBin);
         if (errno != ENOENT) {
           errbuf = fmt::format(FMT_STRING("NOLAUNCH {}"), strerror(errno));
           _writeStr(errbuf.c_str(), errbuf.size(), m_readpipe[1]);
@@ -493,8 +985,7 @@ Connection::Connection(int verbosityLevel) {
         steamBlender += "/blender";
 #endif
         blenderBin = steamBlender.c_str();
-        execlp(blenderBin, blenderBin, "--background", "-P", blenderShellPath.c_str(), "--", readfds.c_str(),
-               writefds.c_str(), vLevel.c_str(), blenderAddonPath.c_str(), nullptr);
+        execBlender(blenderBin);
         if (errno != ENOENT) {
           errbuf = fmt::format(FMT_STRING("NOLAUNCH {}"), strerror(errno));
           _writeStr(errbuf.c_str(), errbuf.size(), m_readpipe[1]);
@@ -503,8 +994,7 @@ Connection::Connection(int verbosityLevel) {
       }
 
       /* Otherwise default blender */
-      execlp(DEFAULT_BLENDER_BIN, DEFAULT_BLENDER_BIN, "--background", "-P", blenderShellPath.c_str(), "--",
-             readfds.c_str(), writefds.c_str(), vLevel.c_str(), blenderAddonPath.c_str(), nullptr);
+      execBlender(DEFAULT_BLENDER_BIN);
       if (errno != ENOENT) {
         errbuf = fmt::format(FMT_STRING("NOLAUNCH {}"), strerror(errno));
         _writeStr(errbuf.c_str(), errbuf.size(), m_readpipe[1]);
@@ -520,6 +1010,9 @@ Connection::Connection(int verbosityLevel) {
     m_blenderProc = pid;
 #endif
 
+    /* Each launch attempt starts a fresh recording, so only the final session is kept */
+    m_recordFile = OpenRecording();
+
     /* Stash error path and unlink existing file */
 #if _WIN32
     m_errPath = hecl::SystemString(TMPDIR) +
@@ -553,8 +1046,13 @@ Connection::Connection(int verbosityLevel) {
                         MinBlenderMajorSearch, MinBlenderMinorSearch);
     } else if (lineStr == "NOADDON") {
       _closePipe();
-      if (blenderAddonPath != _SYS_STR("SKIPINSTALL"))
-        InstallAddon(blenderAddonPath.c_str());
+      if (blenderAddonPath == _SYS_STR("SKIPINSTALL")) {
+        /* Stale stamp; blender lost the addon since it was written */
+        AddonStampValid = false;
+        hecl::Unlink(addonStampPath.c_str());
+        blenderAddonPath = blenderAddonZip;
+      }
+      InstallAddon(blenderAddonPath.c_str());
       ++installAttempt;
       if (installAttempt >= 2)
         BlenderLog.report(logvisor::Fatal, FMT_STRING(_SYS_STR("unable to install blender addon using '{}'")),
@@ -565,6 +1063,8 @@ Connection::Connection(int verbosityLevel) {
       continue;
     } else if (lineStr == "ADDONINSTALLED") {
       _closePipe();
+      WriteAddonStamp(addonStampPath.c_str(), addonStamp);
+      AddonStampValid = true;
       blenderAddonPath = _SYS_STR("SKIPINSTALL");
 #ifndef _WIN32
       waitpid(pid, nullptr, 0);
@@ -578,6 +1078,12 @@ Connection::Connection(int verbosityLevel) {
 
     break;
   }
+
+  m_startupDuration = std::chrono::steady_clock::now() - startTime;
+  if (hecl::VerbosityLevel >= 1)
+    BlenderLog.report(logvisor::Info, FMT_STRING("Blender ready in {} ms ({} launch{})"),
+                      std::chrono::duration_cast<std::chrono::milliseconds>(m_startupDuration).count(), launchCount,
+                      launchCount == 1 ? "" : "es");
 #else
   BlenderLog.report(logvisor::Fatal, FMT_STRING("BlenderConnection not available on UWP"));
 #endif
@@ -654,7 +1160,11 @@ bool Connection::createBlend(const ProjectPath& path, BlendType type) {
                       FMT_STRING("BlenderConnection::createBlend() musn't be called with stream active"));
     return false;
   }
-  _writeStr(fmt::format(FMT_STRING("CREATE \"{}\" {}"), path.getAbsolutePathUTF8(), BlendTypeStrs[int(type)]));
+  m_openDeferred = false;
+  m_blendHash = 0;
+  m_sceneManifest.reset();
+  _writeCommand(fmt::format(FMT_STRING("CREATE \"{}\" {}"), path.getAbsolutePathUTF8(), BlendTypeStrs[int(type)]));
+  ++m_openedBlends;
   if (_isFinished()) {
     /* Delete immediately in case save doesn't occur */
     hecl::Unlink(path.getAbsolutePath().data());
@@ -673,38 +1183,78 @@ bool Connection::openBlend(const ProjectPath& path, bool force) {
   }
   if (!force && path == m_loadedBlend)
     return true;
-  _writeStr(fmt::format(FMT_STRING("OPEN \"{}\""), path.getAbsolutePathUTF8()));
-  if (_isFinished()) {
+
+  /* Type and rig state come from the cache when available; blender only opens the blend once a
+   * command misses the cache */
+  m_openDeferred = false;
+  m_blendHash = 0;
+  m_sceneManifest.reset();
+  BlendTypeCache& typeCache = BlendTypeCache::ForProject(path);
+  const auto known = typeCache.lookup(path);
+  uint64_t fileHash = 0;
+  if (m_cacheEnabled) {
+    m_cacheDir = ProjectPath(path.getProject().getProjectWorkingPath(), _SYS_STR(".hecl/blendercache")).getAbsolutePath();
+    /* An unchanged blend keeps the content hash recorded with its classification; in-project
+     * dependencies are looked up the same way */
+    fileHash = known && known->hash ? known->hash : HashFile(path.getAbsolutePath());
+    std::vector<SystemString> visited{SystemString(path.getAbsolutePath())};
+    m_blendHash = fileHash ? FoldDependencyHashes(path.getProject(), visited.front(), fileHash, visited) : 0;
+  }
+  if (known && known->rigged) {
     m_loadedBlend = path;
-    _writeStr("GETTYPE");
-    std::string typeStr = _readStdString();
-    m_loadedType = BlendType::None;
-    unsigned idx = 0;
-    for (const auto& type : BlendTypeStrs) {
-      if (type == typeStr) {
-        m_loadedType = BlendType(idx);
-        break;
-      }
-      ++idx;
+    m_loadedType = known->type;
+    m_loadedRigged = *known->rigged;
+    m_openDeferred = true;
+    if (m_cacheEnabled && fileHash != known->hash)
+      typeCache.store(path, {m_loadedType, m_loadedRigged, fileHash});
+    return true;
+  }
+  std::string infoKey;
+  if (m_blendHash) {
+    infoKey = _cacheKey("OPEN");
+    if (auto info = _loadCacheEntry(infoKey); info && info->size() == 2 && (*info)[0] < BlendTypeStrs.size()) {
+      m_loadedBlend = path;
+      m_loadedType = BlendType((*info)[0]);
+      m_loadedRigged = (*info)[1] != 0;
+      m_openDeferred = true;
+      typeCache.store(path, {m_loadedType, m_loadedRigged, fileHash});
+      return true;
     }
-    m_loadedRigged = false;
-    if (m_loadedType == BlendType::Mesh) {
-      _writeStr("GETMESHRIGGED");
-      if (_isTrue())
-        m_loadedRigged = true;
+  }
+
+  _writeCommand(fmt::format(FMT_STRING("OPEN \"{}\""), path.getAbsolutePathUTF8()));
+  ++m_openedBlends;
+  if (_isFinished()) {
+    m_loadedBlend = path;
+    std::tie(m_loadedType, m_loadedRigged) = _readOpenInfo();
+    if (!m_died) {
+      if (m_blendHash)
+        _storeCacheEntry(infoKey, {uint8_t(m_loadedType), uint8_t(m_loadedRigged)});
+      typeCache.store(path, {m_loadedType, m_loadedRigged, fileHash});
     }
     return true;
   }
   return false;
 }
 
+/* A successful OPEN is followed by the blend's type and rig state */
+std::pair<BlendType, bool> Connection::_readOpenInfo() {
+  const std::string typeStr = _readStdString();
+  BlendType loadedType = BlendType::None;
+  const auto search = std::find(BlendTypeStrs.cbegin(), BlendTypeStrs.cend(), typeStr);
+  if (search != BlendTypeStrs.cend())
+    loadedType = BlendType(search - BlendTypeStrs.cbegin());
+  const bool rigged = _isTrue();
+  return {loadedType, loadedType == BlendType::Mesh && rigged};
+}
+
 bool Connection::saveBlend() {
   if (m_lock) {
     BlenderLog.report(logvisor::Fatal,
                       FMT_STRING("BlenderConnection::saveBlend() musn't be called with stream active"));
     return false;
   }
-  _writeStr("SAVE");
+  _writeCommand("SAVE");
   return _isFinished();
 }
 
@@ -718,8 +1268,10 @@ void Connection::deleteBlend() {
 
 PyOutStream::PyOutStream(Connection* parent, bool deleteOnError)
 : std::ostream(&m_sbuf), m_parent(parent), m_sbuf(*this, deleteOnError) {
+  /* Python may change the scene */
+  m_parent->m_sceneManifest.reset();
   m_parent->m_pyStreamActive = true;
-  m_parent->_writeStr("PYBEGIN");
+  m_parent->_writeCommand("PYBEGIN");
   m_parent->_checkReady("unable to open PyOutStream with blender"sv);
 }
 
@@ -906,6 +1458,14 @@ void ANIMOutStream::write(unsigned frame, float val) {
     BlenderLog.report(logvisor::Fatal, FMT_STRING("ANIMOutStream keyCount overflow"));
 }
 
+DecodeArena& DecodeArena::operator=(DecodeArena&& other) noexcept {
+  /* Assignment keeps this region for the containers; elements moved in may still live in other's */
+  for (const auto& region : other.m_regions)
+    if (std::find(m_regions.cbegin(), m_regions.cend(), region) == m_regions.cend())
+      m_regions.push_back(region);
+  return *this;
+}
+
 Mesh::SkinBind::SkinBind(Connection& conn) {
   conn._readValue(vg_idx);
   conn._readValue(weight);
@@ -927,10 +1487,13 @@ void Mesh::normalizeSkinBinds() {
 
 Mesh::Mesh(Connection& conn, HMDLTopology topologyIn, int skinSlotCount, bool useLuvs)
 : topology(topologyIn), sceneXf(conn), aabbMin(conn), aabbMax(conn) {
-  conn._readVectorFunc(materialSets, [&]() { conn._readVector(materialSets.emplace_back()); });
+  std::pmr::memory_resource* res = arena.resource();
+  conn._readVectorFunc(materialSets, [&]() { conn._readVector(materialSets.emplace_back(), res); });
+  if (conn.isDead())
+    return;
 
   MeshOptimizer opt(conn, materialSets[0], useLuvs);
-  opt.optimize(*this, skinSlotCount);
+  opt.optimize(*this, skinSlotCount, conn.getMeshThreads());
 
   conn._readVector(boneNames);
   if (boneNames.size())
@@ -940,12 +1503,11 @@ Mesh::Mesh(Connection& conn, HMDLTopology topologyIn, int skinSlotCount, bool us
   /* Custom properties */
   uint32_t propCount;
   conn._readValue(propCount);
-  std::string keyBuf;
-  std::string valBuf;
+  customProps.reserve(propCount);
   for (uint32_t i = 0; i < propCount; ++i) {
-    keyBuf = conn._readStdString();
-    valBuf = conn._readStdString();
-    customProps[keyBuf] = valBuf;
+    std::pmr::string key(res);
+    conn._readString(key);
+    conn._readString(customProps[std::move(key)]);
   }
 
   /* Connect skinned verts to bank slots */
@@ -1027,8 +1589,8 @@ Material::CLR::CLR(Connection& conn) {
   color.read(conn);
 }
 
-Material::Material(Connection& conn) {
-  name = conn._readStdString();
+Material::Material(Connection& conn, std::pmr::memory_resource* res) : name(res), chunks(res), iprops(res) {
+  conn._readString(name);
 
   conn._readValue(passIndex);
   conn._readValue(shaderType);
@@ -1045,8 +1607,9 @@ Material::Material(Connection& conn) {
   conn._readValue(iPropCount);
   iprops.reserve(iPropCount);
   for (uint32_t i = 0; i < iPropCount; ++i) {
-    std::string readStr = conn._readStdString();
-    conn._readValue(iprops[readStr]);
+    std::pmr::string readStr(res);
+    conn._readString(readStr);
+    conn._readValue(iprops[std::move(readStr)]);
   }
 
   conn._readValue(blendMode);
@@ -1057,7 +1620,8 @@ bool Mesh::Surface::Vert::operator==(const Vert& other) const {
          std::tie(other.iPos, other.iNorm, other.iColor, other.iUv, other.iSkin);
 }
 
-static bool VertInBank(const std::vector<uint32_t>& bank, uint32_t sIdx) {
+template <typename Alloc>
+static bool VertInBank(const std::vector<uint32_t, Alloc>& bank, uint32_t sIdx) {
   return std::any_of(bank.cbegin(), bank.cend(), [sIdx](auto index) { return index == sIdx; });
 }
 
@@ -1080,8 +1644,8 @@ void Mesh::SkinBanks::Bank::addSkins(const Mesh& parent, const std::vector<uint3
   }
 }
 
-std::vector<Mesh::SkinBanks::Bank>::iterator Mesh::SkinBanks::addSkinBank(int skinSlotCount) {
-  banks.emplace_back();
+std::pmr::vector<Mesh::SkinBanks::Bank>::iterator Mesh::SkinBanks::addSkinBank(int skinSlotCount) {
+  banks.emplace_back(banks.get_allocator().resource());
   if (skinSlotCount > 0)
     banks.back().m_skinIdxs.reserve(skinSlotCount);
   return banks.end() - 1;
@@ -1093,7 +1657,7 @@ uint32_t Mesh::SkinBanks::addSurface(const Mesh& mesh, const Surface& surf, int
   std::vector<uint32_t> toAdd;
   if (skinSlotCount > 0)
     toAdd.reserve(skinSlotCount);
-  std::vector<Bank>::iterator bankIt = banks.begin();
+  std::pmr::vector<Bank>::iterator bankIt = banks.begin();
   for (;;) {
     bool done = true;
     for (; bankIt != banks.end(); ++bankIt) {
@@ -1128,14 +1692,14 @@ uint32_t Mesh::SkinBanks::addSurface(const Mesh& mesh, const Surface& surf, int
 }
 
 ColMesh::ColMesh(Connection& conn) {
-  conn._readVector(materials);
+  conn._readVector(materials, arena.resource());
   conn._readVector(verts);
   conn._readVector(edges);
   conn._readVector(trianges);
 }
 
-ColMesh::Material::Material(Connection& conn) {
-  name = conn._readStdString();
+ColMesh::Material::Material(Connection& conn, std::pmr::memory_resource* res) : name(res) {
+  conn._readString(name);
   conn._readBuf(&unknown, 42);
 }
 
@@ -1152,7 +1716,7 @@ World::Area::Dock::Dock(Connection& conn) {
   targetDock.read(conn);
 }
 
-World::Area::Area(Connection& conn) {
+World::Area::Area(Connection& conn, std::pmr::memory_resource* res) : docks(res) {
   std::string name = conn._readStdString();
 
   path.assign(conn.getBlendPath().getParentPath(), name);
@@ -1162,7 +1726,7 @@ World::Area::Area(Connection& conn) {
   conn._readVector(docks);
 }
 
-World::World(Connection& conn) { conn._readVector(areas); }
+World::World(Connection& conn) { conn._readVector(areas, arena.resource()); }
 
 Light::Light(Connection& conn) : sceneXf(conn), color(conn) {
   conn._readBuf(&layer, 29);
@@ -1214,25 +1778,33 @@ MapUniverse::MapUniverse(Connection& conn) {
 }
 
 Actor::Actor(Connection& conn) {
-  conn._readVector(armatures);
-  conn._readVector(subtypes);
-  conn._readVector(attachments);
-  conn._readVector(actions);
+  std::pmr::memory_resource* res = arena.resource();
+  conn._readVector(armatures, res);
+  conn._readVector(subtypes, res);
+  conn._readVector(attachments, res);
+  conn._readVector(actions, res);
 }
 
 PathMesh::PathMesh(Connection& conn) { conn._readVector(data); }
 
-const Bone* Armature::lookupBone(const char* name) const {
-  for (const Bone& b : bones)
-    if (b.name == name)
-      return &b;
-  return nullptr;
+int32_t Armature::lookupBoneIdx(std::string_view name) const {
+  const uint64_t hash = hecl::Hash(name).val64();
+  auto it = std::lower_bound(m_nameIndex.cbegin(), m_nameIndex.cend(), std::make_pair(hash, INT32_MIN));
+  for (; it != m_nameIndex.cend() && it->first == hash; ++it)
+    if (m_bones[it->second].name == name)
+      return it->second;
+  return -1;
+}
+
+const Bone* Armature::lookupBone(std::string_view name) const {
+  const int32_t idx = lookupBoneIdx(name);
+  return idx < 0 ? nullptr : &m_bones[idx];
 }
 
 const Bone* Armature::getParent(const Bone* bone) const {
   if (bone->parent < 0)
     return nullptr;
-  return &bones[bone->parent];
+  return &m_bones[bone->parent];
 }
 
 const Bone* Armature::getChild(const Bone* bone, std::size_t child) const {
@@ -1241,60 +1813,102 @@ const Bone* Armature::getChild(const Bone* bone, std::size_t child) const {
   int32_t cIdx = bone->children[child];
   if (cIdx < 0)
     return nullptr;
-  return &bones[cIdx];
+  return &m_bones[cIdx];
 }
 
-const Bone* Armature::getRoot() const {
-  for (const Bone& b : bones)
-    if (b.parent < 0)
-      return &b;
-  return nullptr;
+const Bone* Armature::getRoot() const { return m_rootIdx < 0 ? nullptr : &m_bones[m_rootIdx]; }
+
+std::vector<int32_t> Armature::getParentChain(const Bone* bone) const {
+  std::vector<int32_t> chain;
+  /* Bounded by the bone count in case of a malformed cycle */
+  for (int32_t idx = int32_t(bone - m_bones.data()); idx >= 0 && chain.size() < m_bones.size(); idx = m_bones[idx].parent)
+    chain.push_back(idx);
+  return chain;
 }
 
-Armature::Armature(Connection& conn) { conn._readVector(bones); }
+bool Armature::isAncestor(const Bone* ancestor, const Bone* bone) const {
+  std::size_t depth = 0;
+  for (const Bone* b = getParent(bone); b && depth < m_bones.size(); b = getParent(b), ++depth)
+    if (b == ancestor)
+      return true;
+  return false;
+}
 
-Bone::Bone(Connection& conn) {
-  name = conn._readStdString();
+void Armature::buildIndex() {
+  m_nameIndex.clear();
+  m_nameIndex.reserve(m_bones.size());
+  m_rootIdx = -1;
+  for (std::size_t i = 0; i < m_bones.size(); ++i) {
+    m_nameIndex.emplace_back(hecl::Hash(m_bones[i].name).val64(), int32_t(i));
+    if (m_rootIdx < 0 && m_bones[i].parent < 0)
+      m_rootIdx = int32_t(i);
+  }
+  std::sort(m_nameIndex.begin(), m_nameIndex.end());
+}
+
+Armature& Armature::operator=(const Armature& other) {
+  m_bones = other.m_bones;
+  m_nameIndex = other.m_nameIndex;
+  m_rootIdx = other.m_rootIdx;
+  return *this;
+}
+
+Armature& Armature::operator=(Armature&& other) noexcept {
+  m_bones = std::move(other.m_bones);
+  m_nameIndex = std::move(other.m_nameIndex);
+  m_rootIdx = other.m_rootIdx;
+  return *this;
+}
+
+Armature::Armature(Connection& conn, std::pmr::memory_resource* res) : bones(m_bones), m_bones(res), m_nameIndex(res) {
+  conn._readVector(m_bones, res);
+  buildIndex();
+}
+
+Bone::Bone(Connection& conn, std::pmr::memory_resource* res) : name(res), children(res) {
+  conn._readString(name);
   origin.read(conn);
   conn._readValue(parent);
   conn._readVector(children);
 }
 
-Actor::ActorArmature::ActorArmature(Connection& conn) {
-  name = conn._readStdString();
+Actor::ActorArmature::ActorArmature(Connection& conn, std::pmr::memory_resource* res) : name(res) {
+  conn._readString(name);
   path = conn._readPath();
-  armature.emplace(conn);
+  armature.emplace(conn, res);
 }
 
-Actor::Subtype::OverlayMesh::OverlayMesh(Connection& conn) {
-  name = conn._readStdString();
-  cskrId = conn._readStdString();
+Actor::Subtype::OverlayMesh::OverlayMesh(Connection& conn, std::pmr::memory_resource* res) : name(res), cskrId(res) {
+  conn._readString(name);
+  conn._readString(cskrId);
   mesh = conn._readPath();
 }
 
-Actor::Subtype::Subtype(Connection& conn) {
-  name = conn._readStdString();
-  cskrId = conn._readStdString();
+Actor::Subtype::Subtype(Connection& conn, std::pmr::memory_resource* res)
+: name(res), cskrId(res), overlayMeshes(res) {
+  conn._readString(name);
+  conn._readString(cskrId);
   mesh = conn._readPath();
   conn._readValue(armature);
-  conn._readVector(overlayMeshes);
+  conn._readVector(overlayMeshes, res);
 }
 
-Actor::Attachment::Attachment(Connection& conn) {
-  name = conn._readStdString();
-  cskrId = conn._readStdString();
+Actor::Attachment::Attachment(Connection& conn, std::pmr::memory_resource* res) : name(res), cskrId(res) {
+  conn._readString(name);
+  conn._readString(cskrId);
   mesh = conn._readPath();
   conn._readValue(armature);
 }
 
-Action::Action(Connection& conn) {
-  name = conn._readStdString();
-  animId = conn._readStdString();
+Action::Action(Connection& conn, std::pmr::memory_resource* res)
+: name(res), animId(res), frames(res), channels(res), subtypeAABBs(res) {
+  conn._readString(name);
+  conn._readString(animId);
   conn._readValue(interval);
   conn._readValue(additive);
   conn._readValue(looping);
   conn._readVector(frames);
-  conn._readVector(channels);
+  conn._readVector(channels, res);
   conn._readVectorFunc(subtypeAABBs, [&]() {
     auto& p = subtypeAABBs.emplace_back();
     p.first.read(conn);
@@ -1302,8 +1916,8 @@ Action::Action(Connection& conn) {
   });
 }
 
-Action::Channel::Channel(Connection& conn) {
-  boneName = conn._readStdString();
+Action::Channel::Channel(Connection& conn, std::pmr::memory_resource* res) : boneName(res), keys(res) {
+  conn._readString(boneName);
   conn._readValue(attrMask);
   conn._readVector(keys, attrMask);
 }
@@ -1321,39 +1935,106 @@ Action::Channel::Key::Key(Connection& conn, uint32_t attrMask) {
 
 DataStream::DataStream(Connection* parent) : m_parent(parent) {
   m_parent->m_dataStreamActive = true;
-  m_parent->_writeStr("DATABEGIN");
+  if (m_parent->m_openDeferred) {
+    m_parent->m_dataDeferred = true;
+    return;
+  }
+  m_parent->_writeCommand("DATABEGIN");
   m_parent->_checkReady("unable to open DataStream with blender"sv);
 }
 
 void DataStream::close() {
   if (m_parent && m_parent->m_lock) {
-    m_parent->_writeStr("DATAEND");
-    m_parent->_checkDone("unable to close DataStream with blender"sv);
+    if (m_parent->m_dataDeferred)
+      m_parent->m_dataDeferred = false;
+    else {
+      m_parent->_writeStr("DATAEND");
+      m_parent->_checkDone("unable to close DataStream with blender"sv);
+    }
     m_parent->m_dataStreamActive = false;
     m_parent->m_lock = false;
   }
 }
 
-std::vector<std::string> DataStream::getMeshList() {
-  m_parent->_writeStr("MESHLIST");
+void DataStream::_issueMeshList(bool pipelined) { m_parent->_writeCommand("MESHLIST", pipelined); }
+
+void DataStream::_issueLightList(bool pipelined) { m_parent->_writeCommand("LIGHTLIST", pipelined); }
+
+std::vector<std::string> DataStream::_replyNameList() {
   std::vector<std::string> retval;
   m_parent->_readVector(retval);
   return retval;
 }
 
+std::vector<std::pair<std::string, std::string>> DataStream::_replyNamePairs() {
+  std::vector<std::pair<std::string, std::string>> ret;
+  m_parent->_readVectorFunc(ret, [&]() {
+    auto& [name, id] = ret.emplace_back();
+    name = m_parent->_readStdString();
+    id = m_parent->_readStdString();
+  });
+  return ret;
+}
+
+const SceneManifest& DataStream::getSceneManifest() {
+  if (m_parent->m_sceneManifest)
+    return *m_parent->m_sceneManifest;
+
+  SceneManifest manifest;
+  {
+    const auto cached = m_parent->_cacheReply();
+    m_parent->_writeCommand("SCENEMANIFEST");
+    m_parent->_checkOk("unable to get scene manifest"sv);
+    manifest.meshes = _replyNameList();
+    manifest.lights = _replyNameList();
+    uint8_t hasAABB;
+    m_parent->_readValue(hasAABB);
+    if (hasAABB) {
+      Vector3f minPt(*m_parent);
+      Vector3f maxPt(*m_parent);
+      manifest.aabb.emplace(minPt.val, maxPt.val);
+    }
+    for (auto* names : {&manifest.subtypes, &manifest.actions, &manifest.attachments}) {
+      uint8_t hasNames;
+      m_parent->_readValue(hasNames);
+      if (hasNames)
+        names->emplace(_replyNamePairs());
+    }
+  }
+
+  /* A dead connection decoded zeroes; don't keep them around */
+  if (m_parent->m_died) {
+    static const SceneManifest Empty;
+    return Empty;
+  }
+  return m_parent->m_sceneManifest.emplace(std::move(manifest));
+}
+
+std::vector<std::string> DataStream::getMeshList() {
+  if (m_parent->m_sceneManifest)
+    return m_parent->m_sceneManifest->meshes;
+  const auto cached = m_parent->_cacheReply();
+  _issueMeshList();
+  return _replyNameList();
+}
+
 std::vector<std::string> DataStream::getLightList() {
-  m_parent->_writeStr("LIGHTLIST");
-  std::vector<std::string> retval;
-  m_parent->_readVector(retval);
-  return retval;
+  if (m_parent->m_sceneManifest)
+    return m_parent->m_sceneManifest->lights;
+  const auto cached = m_parent->_cacheReply();
+  _issueLightList();
+  return _replyNameList();
 }
 
-std::pair<atVec3f, atVec3f> DataStream::getMeshAABB() {
+void DataStream::_issueMeshAABB(bool pipelined) {
   if (m_parent->m_loadedType != BlendType::Mesh && m_parent->m_loadedType != BlendType::Actor)
     BlenderLog.report(logvisor::Fatal, FMT_STRING(_SYS_STR("{} is not a MESH or ACTOR blend")),
                       m_parent->m_loadedBlend.getAbsolutePath());
 
-  m_parent->_writeStr("MESHAABB");
+  m_parent->_writeCommand("MESHAABB", pipelined);
+}
+
+std::pair<atVec3f, atVec3f> DataStream::_replyMeshAABB() {
   m_parent->_checkOk("unable get AABB"sv);
 
   Vector3f minPt(*m_parent);
@@ -1361,6 +2042,14 @@ std::pair<atVec3f, atVec3f> DataStream::getMeshAABB() {
   return std::make_pair(minPt.val, maxPt.val);
 }
 
+std::pair<atVec3f, atVec3f> DataStream::getMeshAABB() {
+  if (m_parent->m_sceneManifest && m_parent->m_sceneManifest->aabb)
+    return *m_parent->m_sceneManifest->aabb;
+  const auto cached = m_parent->_cacheReply();
+  _issueMeshAABB();
+  return _replyMeshAABB();
+}
+
 const char* DataStream::MeshOutputModeString(HMDLTopology topology) {
   static constexpr std::array<const char*, 2> STRS{"TRIANGLES", "TRISTRIPS"};
   return STRS[int(topology)];
@@ -1371,40 +2060,60 @@ Mesh DataStream::compileMesh(HMDLTopology topology, int skinSlotCount) {
     BlenderLog.report(logvisor::Fatal, FMT_STRING(_SYS_STR("{} is not a MESH blend")),
                       m_parent->getBlendPath().getAbsolutePath());
 
-  m_parent->_writeStr("MESHCOMPILE");
+  const auto cached = m_parent->_cacheReply();
+  m_parent->_writeCommand("MESHCOMPILE");
   m_parent->_checkOk("unable to cook mesh"sv);
 
   return Mesh(*m_parent, topology, skinSlotCount);
 }
 
-Mesh DataStream::compileMesh(std::string_view name, HMDLTopology topology, int skinSlotCount, bool useLuv) {
+void DataStream::_issueMesh(std::string_view name, bool useLuv, bool pipelined) {
   if (m_parent->getBlendType() != BlendType::Area)
     BlenderLog.report(logvisor::Fatal, FMT_STRING(_SYS_STR("{} is not an AREA blend")),
                       m_parent->getBlendPath().getAbsolutePath());
 
-  m_parent->_writeStr(fmt::format(FMT_STRING("MESHCOMPILENAME {} {}"), name, int(useLuv)));
+  m_parent->_writeCommand(fmt::format(FMT_STRING("MESHCOMPILENAME {} {}"), name, int(useLuv)), pipelined);
+}
+
+Mesh DataStream::_replyMesh(HMDLTopology topology, int skinSlotCount, bool useLuv) {
   m_parent->_checkOk("unable to cook mesh"sv);
 
   return Mesh(*m_parent, topology, skinSlotCount, useLuv);
 }
 
-ColMesh DataStream::compileColMesh(std::string_view name) {
+Mesh DataStream::compileMesh(std::string_view name, HMDLTopology topology, int skinSlotCount, bool useLuv) {
+  const auto cached = m_parent->_cacheReply();
+  _issueMesh(name, useLuv);
+  return _replyMesh(topology, skinSlotCount, useLuv);
+}
+
+void DataStream::_issueColMesh(std::string_view name, bool pipelined) {
   if (m_parent->getBlendType() != BlendType::Area)
     BlenderLog.report(logvisor::Fatal, FMT_STRING(_SYS_STR("{} is not an AREA blend")),
                       m_parent->getBlendPath().getAbsolutePath());
 
-  m_parent->_writeStr(fmt::format(FMT_STRING("MESHCOMPILENAMECOLLISION {}"), name));
+  m_parent->_writeCommand(fmt::format(FMT_STRING("MESHCOMPILENAMECOLLISION {}"), name), pipelined);
+}
+
+ColMesh DataStream::_replyColMesh() {
   m_parent->_checkOk("unable to cook collision mesh"sv);
 
   return ColMesh(*m_parent);
 }
 
+ColMesh DataStream::compileColMesh(std::string_view name) {
+  const auto cached = m_parent->_cacheReply();
+  _issueColMesh(name);
+  return _replyColMesh();
+}
+
 std::vector<ColMesh> DataStream::compileColMeshes() {
   if (m_parent->getBlendType() != BlendType::ColMesh)
     BlenderLog.report(logvisor::Fatal, FMT_STRING(_SYS_STR("{} is not a CMESH blend")),
                       m_parent->getBlendPath().getAbsolutePath());
 
-  m_parent->_writeStr("MESHCOMPILECOLLISIONALL");
+  const auto cached = m_parent->_cacheReply();
+  m_parent->_writeCommand("MESHCOMPILECOLLISIONALL");
   m_parent->_checkOk("unable to cook collision meshes"sv);
 
   std::vector<ColMesh> ret;
@@ -1417,7 +2126,8 @@ std::vector<Light> DataStream::compileLights() {
     BlenderLog.report(logvisor::Fatal, FMT_STRING(_SYS_STR("{} is not an AREA blend")),
                       m_parent->getBlendPath().getAbsolutePath());
 
-  m_parent->_writeStr("LIGHTCOMPILEALL");
+  const auto cached = m_parent->_cacheReply();
+  m_parent->_writeCommand("LIGHTCOMPILEALL");
   m_parent->_checkOk("unable to gather all lights"sv);
 
   std::vector<Light> ret;
@@ -1430,7 +2140,8 @@ PathMesh DataStream::compilePathMesh() {
     BlenderLog.report(logvisor::Fatal, FMT_STRING(_SYS_STR("{} is not a PATH blend")),
                       m_parent->getBlendPath().getAbsolutePath());
 
-  m_parent->_writeStr("MESHCOMPILEPATH");
+  const auto cached = m_parent->_cacheReply();
+  m_parent->_writeCommand("MESHCOMPILEPATH");
   m_parent->_checkOk("unable to compile path mesh"sv);
 
   return PathMesh(*m_parent);
@@ -1441,12 +2152,12 @@ std::vector<uint8_t> DataStream::compileGuiFrame(int version) {
     BlenderLog.report(logvisor::Fatal, FMT_STRING(_SYS_STR("{} is not a FRAME blend")),
                       m_parent->getBlendPath().getAbsolutePath());
 
-  m_parent->_writeStr(fmt::format(FMT_STRING("FRAMECOMPILE {}"), version));
+  m_parent->_writeCommand(fmt::format(FMT_STRING("FRAMECOMPILE {}"), version));
   m_parent->_checkOk("unable to compile frame"sv);
 
   while (true) {
     std::string readStr = m_parent->_readStdString();
-    if (readStr == "FRAMEDONE")
+    if (readStr == "FRAMEDONE" || m_parent->isDead())
       break;
 
     SystemStringConv absolute(readStr);
@@ -1466,8 +2177,9 @@ std::vector<uint8_t> DataStream::compileGuiFrame(int version) {
   return ret;
 }
 
-std::vector<ProjectPath> DataStream::getTextures() {
-  m_parent->_writeStr("GETTEXTURES");
+void DataStream::_issueTextures(bool pipelined) { m_parent->_writeCommand("GETTEXTURES", pipelined); }
+
+std::vector<ProjectPath> DataStream::_replyTextures() {
   m_parent->_checkOk("unable to get textures"sv);
 
   std::vector<ProjectPath> texs;
@@ -1476,12 +2188,164 @@ std::vector<ProjectPath> DataStream::getTextures() {
   return texs;
 }
 
+std::vector<ProjectPath> DataStream::getTextures() {
+  const auto cached = m_parent->_cacheReply();
+  _issueTextures();
+  return _replyTextures();
+}
+
+DataStream::Pipeline::Pipeline(DataStream& stream, std::size_t maxInFlight)
+: m_stream(stream), m_maxInFlight(std::max(maxInFlight, std::size_t(1))) {}
+
+void DataStream::Pipeline::_reserve() {
+  while (m_replies.size() >= m_maxInFlight)
+    dispatchOne();
+}
+
+void DataStream::Pipeline::_push(std::function<void()> reply) {
+  m_replies.emplace_back(m_stream.m_parent->m_curStats, std::move(reply));
+}
+
+bool DataStream::Pipeline::dispatchOne() {
+  if (m_replies.empty())
+    return false;
+  auto [stats, reply] = std::move(m_replies.front());
+  m_replies.pop_front();
+  m_stream.m_parent->_beginCommandStats(stats);
+  reply();
+  return true;
+}
+
+void DataStream::Pipeline::drain() {
+  while (dispatchOne()) {}
+}
+
+bool DataStream::Pipeline::replyReady(std::chrono::milliseconds timeout) const {
+  return !m_replies.empty() && m_stream.m_parent->_replyAvailable(timeout);
+}
+
+std::size_t DataStream::Pipeline::DispatchReady(const std::vector<Pipeline*>& pipelines,
+                                                std::chrono::milliseconds timeout) {
+  std::size_t dispatched = 0;
+#if _WIN32
+  const auto deadline = std::chrono::steady_clock::now() + timeout;
+  for (;;) {
+    for (Pipeline* pipeline : pipelines)
+      if (pipeline->replyReady())
+        dispatched += pipeline->dispatchOne();
+    if (dispatched || std::chrono::steady_clock::now() >= deadline)
+      break;
+    Sleep(1);
+  }
+#else
+  std::vector<pollfd> pfds;
+  std::vector<Pipeline*> polled;
+  pfds.reserve(pipelines.size());
+  polled.reserve(pipelines.size());
+  for (Pipeline* pipeline : pipelines) {
+    if (!pipeline->inFlight())
+      continue;
+    if (pipeline->m_stream.m_parent->isDead()) {
+      dispatched += pipeline->dispatchOne();
+      continue;
+    }
+    pfds.push_back({pipeline->m_stream.m_parent->m_readpipe[0], POLLIN, 0});
+    polled.push_back(pipeline);
+  }
+  if (dispatched || pfds.empty())
+    return dispatched;
+  int ret;
+  while ((ret = poll(pfds.data(), pfds.size(), int(timeout.count()))) < 0 && errno == EINTR) {}
+  for (std::size_t i = 0; ret > 0 && i < pfds.size(); ++i)
+    if (pfds[i].revents)
+      dispatched += polled[i]->dispatchOne();
+#endif
+  return dispatched;
+}
+
+void DataStream::Pipeline::getMeshList(Handler<std::vector<std::string>> handler) {
+  _reserve();
+  m_stream._issueMeshList(true);
+  _push([this, handler = std::move(handler)]() { handler(m_stream._replyNameList()); });
+}
+
+void DataStream::Pipeline::getLightList(Handler<std::vector<std::string>> handler) {
+  _reserve();
+  m_stream._issueLightList(true);
+  _push([this, handler = std::move(handler)]() { handler(m_stream._replyNameList()); });
+}
+
+void DataStream::Pipeline::getMeshAABB(Handler<std::pair<atVec3f, atVec3f>> handler) {
+  _reserve();
+  m_stream._issueMeshAABB(true);
+  _push([this, handler = std::move(handler)]() { handler(m_stream._replyMeshAABB()); });
+}
+
+void DataStream::Pipeline::compileMesh(std::string_view name, HMDLTopology topology, Handler<Mesh> handler,
+                                       int skinSlotCount, bool useLuv) {
+  _reserve();
+  m_stream._issueMesh(name, useLuv, true);
+  _push([this, topology, skinSlotCount, useLuv, handler = std::move(handler)]() {
+    handler(m_stream._replyMesh(topology, skinSlotCount, useLuv));
+  });
+}
+
+void DataStream::Pipeline::compileColMesh(std::string_view name, Handler<ColMesh> handler) {
+  _reserve();
+  m_stream._issueColMesh(name, true);
+  _push([this, handler = std::move(handler)]() { handler(m_stream._replyColMesh()); });
+}
+
+void DataStream::Pipeline::getTextures(Handler<std::vector<ProjectPath>> handler) {
+  _reserve();
+  m_stream._issueTextures(true);
+  _push([this, handler = std::move(handler)]() { handler(m_stream._replyTextures()); });
+}
+
+std::future<std::vector<std::string>> DataStream::Pipeline::getMeshList() {
+  auto [future, handler] = _deferred<std::vector<std::string>>();
+  getMeshList(std::move(handler));
+  return std::move(future);
+}
+
+std::future<std::vector<std::string>> DataStream::Pipeline::getLightList() {
+  auto [future, handler] = _deferred<std::vector<std::string>>();
+  getLightList(std::move(handler));
+  return std::move(future);
+}
+
+std::future<std::pair<atVec3f, atVec3f>> DataStream::Pipeline::getMeshAABB() {
+  auto [future, handler] = _deferred<std::pair<atVec3f, atVec3f>>();
+  getMeshAABB(std::move(handler));
+  return std::move(future);
+}
+
+std::future<Mesh> DataStream::Pipeline::compileMesh(std::string_view name, HMDLTopology topology, int skinSlotCount,
+                                                    bool useLuv) {
+  auto [future, handler] = _deferred<Mesh>();
+  compileMesh(name, topology, std::move(handler), skinSlotCount, useLuv);
+  return std::move(future);
+}
+
+std::future<ColMesh> DataStream::Pipeline::compileColMesh(std::string_view name) {
+  auto [future, handler] = _deferred<ColMesh>();
+  compileColMesh(name, std::move(handler));
+  return std::move(future);
+}
+
+std::future<std::vector<ProjectPath>> DataStream::Pipeline::getTextures() {
+  auto [future, handler] = _deferred<std::vector<ProjectPath>>();
+  getTextures(std::move(handler));
+  return std::move(future);
+}
+
 Actor DataStream::compileActor() {
   if (m_parent->getBlendType() != BlendType::Actor)
     BlenderLog.report(logvisor::Fatal, FMT_STRING(_SYS_STR("{} is not an ACTOR blend")),
                       m_parent->getBlendPath().getAbsolutePath());
 
-  m_parent->_writeStr("ACTORCOMPILE");
+  const auto cached = m_parent->_cacheReply();
+  m_parent->_writeCommand("ACTORCOMPILE");
   m_parent->_checkOk("unable to compile actor"sv);
 
   return Actor(*m_parent);
@@ -1492,7 +2356,8 @@ Actor DataStream::compileActorCharacterOnly() {
     BlenderLog.report(logvisor::Fatal, FMT_STRING(_SYS_STR("{} is not an ACTOR blend")),
                       m_parent->getBlendPath().getAbsolutePath());
 
-  m_parent->_writeStr("ACTORCOMPILECHARACTERONLY");
+  const auto cached = m_parent->_cacheReply();
+  m_parent->_writeCommand("ACTORCOMPILECHARACTERONLY");
   m_parent->_checkOk("unable to compile actor"sv);
 
   return Actor(*m_parent);
@@ -1503,7 +2368,8 @@ Armature DataStream::compileArmature() {
     BlenderLog.report(logvisor::Fatal, FMT_STRING(_SYS_STR("{} is not an ARMATURE blend")),
                       m_parent->getBlendPath().getAbsolutePath());
 
-  m_parent->_writeStr("ARMATURECOMPILE");
+  const auto cached = m_parent->_cacheReply();
+  m_parent->_writeCommand("ARMATURECOMPILE");
   m_parent->_checkOk("unable to compile armature"sv);
 
   return Armature(*m_parent);
@@ -1514,7 +2380,8 @@ Action DataStream::compileActionChannelsOnly(std::string_view name) {
     BlenderLog.report(logvisor::Fatal, FMT_STRING(_SYS_STR("{} is not an ACTOR blend")),
                       m_parent->getBlendPath().getAbsolutePath());
 
-  m_parent->_writeStr(fmt::format(FMT_STRING("ACTIONCOMPILECHANNELSONLY {}"), name));
+  const auto cached = m_parent->_cacheReply();
+  m_parent->_writeCommand(fmt::format(FMT_STRING("ACTIONCOMPILECHANNELSONLY {}"), name));
   m_parent->_checkOk("unable to compile action"sv);
 
   return Action(*m_parent);
@@ -1525,7 +2392,8 @@ World DataStream::compileWorld() {
     BlenderLog.report(logvisor::Fatal, FMT_STRING(_SYS_STR("{} is not an WORLD blend")),
                       m_parent->getBlendPath().getAbsolutePath());
 
-  m_parent->_writeStr("WORLDCOMPILE");
+  const auto cached = m_parent->_cacheReply();
+  m_parent->_writeCommand("WORLDCOMPILE");
   m_parent->_checkOk("unable to compile world"sv);
 
   return World(*m_parent);
@@ -1536,17 +2404,14 @@ std::vector<std::pair<std::string, std::string>> DataStream::getSubtypeNames() {
     BlenderLog.report(logvisor::Fatal, FMT_STRING(_SYS_STR("{} is not an ACTOR blend")),
                       m_parent->getBlendPath().getAbsolutePath());
 
-  m_parent->_writeStr("GETSUBTYPENAMES");
-  m_parent->_checkOk("unable to get subtypes of actor"sv);
+  if (m_parent->m_sceneManifest && m_parent->m_sceneManifest->subtypes)
+    return *m_parent->m_sceneManifest->subtypes;
 
-  std::vector<std::pair<std::string, std::string>> ret;
-  m_parent->_readVectorFunc(ret, [&]() {
-    auto& [name, cskrId] = ret.emplace_back();
-    name = m_parent->_readStdString();
-    cskrId = m_parent->_readStdString();
-  });
+  const auto cached = m_parent->_cacheReply();
+  m_parent->_writeCommand("GETSUBTYPENAMES");
+  m_parent->_checkOk("unable to get subtypes of actor"sv);
 
-  return ret;
+  return _replyNamePairs();
 }
 
 std::vector<std::pair<std::string, std::string>> DataStream::getActionNames() {
@@ -1554,17 +2419,14 @@ std::vector<std::pair<std::string, std::string>> DataStream::getActionNames() {
     BlenderLog.report(logvisor::Fatal, FMT_STRING(_SYS_STR("{} is not an ACTOR blend")),
                       m_parent->getBlendPath().getAbsolutePath());
 
-  m_parent->_writeStr("GETACTIONNAMES");
-  m_parent->_checkOk("unable to get actions of actor"sv);
+  if (m_parent->m_sceneManifest && m_parent->m_sceneManifest->actions)
+    return *m_parent->m_sceneManifest->actions;
 
-  std::vector<std::pair<std::string, std::string>> ret;
-  m_parent->_readVectorFunc(ret, [&]() {
-    auto& [name, animId] = ret.emplace_back();
-    name = m_parent->_readStdString();
-    animId = m_parent->_readStdString();
-  });
+  const auto cached = m_parent->_cacheReply();
+  m_parent->_writeCommand("GETACTIONNAMES");
+  m_parent->_checkOk("unable to get actions of actor"sv);
 
-  return ret;
+  return _replyNamePairs();
 }
 
 std::vector<std::pair<std::string, std::string>> DataStream::getSubtypeOverlayNames(std::string_view name) {
@@ -1572,17 +2434,11 @@ std::vector<std::pair<std::string, std::string>> DataStream::getSubtypeOverlayNa
     BlenderLog.report(logvisor::Fatal, FMT_STRING(_SYS_STR("{} is not an ACTOR blend")),
                       m_parent->getBlendPath().getAbsolutePath());
 
-  m_parent->_writeStr(fmt::format(FMT_STRING("GETSUBTYPEOVERLAYNAMES {}"), name));
+  const auto cached = m_parent->_cacheReply();
+  m_parent->_writeCommand(fmt::format(FMT_STRING("GETSUBTYPEOVERLAYNAMES {}"), name));
   m_parent->_checkOk("unable to get subtype overlays of actor"sv);
 
-  std::vector<std::pair<std::string, std::string>> ret;
-  m_parent->_readVectorFunc(ret, [&]() {
-    auto& [subtypeName, cskrId] = ret.emplace_back();
-    subtypeName = m_parent->_readStdString();
-    cskrId = m_parent->_readStdString();
-  });
-
-  return ret;
+  return _replyNamePairs();
 }
 
 std::vector<std::pair<std::string, std::string>> DataStream::getAttachmentNames() {
@@ -1590,17 +2446,14 @@ std::vector<std::pair<std::string, std::string>> DataStream::getAttachmentNames(
     BlenderLog.report(logvisor::Fatal, FMT_STRING(_SYS_STR("{} is not an ACTOR blend")),
                       m_parent->getBlendPath().getAbsolutePath());
 
-  m_parent->_writeStr("GETATTACHMENTNAMES");
-  m_parent->_checkOk("unable to get attachments of actor"sv);
+  if (m_parent->m_sceneManifest && m_parent->m_sceneManifest->attachments)
+    return *m_parent->m_sceneManifest->attachments;
 
-  std::vector<std::pair<std::string, std::string>> ret;
-  m_parent->_readVectorFunc(ret, [&]() {
-    auto& [name, cskrId] = ret.emplace_back();
-    name = m_parent->_readStdString();
-    cskrId = m_parent->_readStdString();
-  });
+  const auto cached = m_parent->_cacheReply();
+  m_parent->_writeCommand("GETATTACHMENTNAMES");
+  m_parent->_checkOk("unable to get attachments of actor"sv);
 
-  return ret;
+  return _replyNamePairs();
 }
 
 std::unordered_map<std::string, Matrix3f> DataStream::getBoneMatrices(std::string_view name) {
@@ -1611,28 +2464,33 @@ std::unordered_map<std::string, Matrix3f> DataStream::getBoneMatrices(std::strin
     BlenderLog.report(logvisor::Fatal, FMT_STRING(_SYS_STR("{} is not an ACTOR blend")),
                       m_parent->getBlendPath().getAbsolutePath());
 
-  m_parent->_writeStr(fmt::format(FMT_STRING("GETBONEMATRICES {}"), name));
+  const auto cached = m_parent->_cacheReply();
+  m_parent->_writeCommand(fmt::format(FMT_STRING("GETBONEMATRICES {}"), name));
   m_parent->_checkOk("unable to get matrices of armature"sv);
 
-  std::unordered_map<std::string, Matrix3f> ret;
+  std::vector<std::string> names;
+  m_parent->_readVector(names);
 
-  uint32_t boneCount;
-  m_parent->_readValue(boneCount);
-  ret.reserve(boneCount);
-  for (uint32_t i = 0; i < boneCount; ++i) {
-    std::string mat_name = m_parent->_readStdString();
+  /* Rotation parts arrive as a single row-major frame of 3x3 matrices */
+  const uint32_t matCount = m_parent->_readArrayFrame('f', 9);
+  if (matCount != names.size() && !m_parent->m_died)
+    BlenderLog.report(logvisor::Fatal, FMT_STRING("received {} bone matrices for {} bones"), matCount, names.size());
+  std::vector<float> floats(std::size_t(matCount) * 9);
+  if (matCount)
+    m_parent->_readBuf(floats.data(), sizeof(float) * floats.size());
 
+  std::unordered_map<std::string, Matrix3f> ret;
+  ret.reserve(matCount);
+  for (uint32_t i = 0; i < matCount; ++i) {
+    const float* mat = &floats[std::size_t(i) * 9];
     Matrix3f matOut;
     for (int mat_i = 0; mat_i < 3; ++mat_i) {
-      for (int mat_j = 0; mat_j < 3; ++mat_j) {
-        float val;
-        m_parent->_readValue(val);
-        matOut[mat_i].simd[mat_j] = val;
-      }
+      for (int mat_j = 0; mat_j < 3; ++mat_j)
+        matOut[mat_i].simd[mat_j] = mat[mat_i * 3 + mat_j];
       matOut[mat_i].simd[3] = 0.f;
     }
 
-    ret.emplace(std::move(mat_name), std::move(matOut));
+    ret.emplace(std::move(names[i]), std::move(matOut));
   }
 
   return ret;
@@ -1647,7 +2505,7 @@ bool DataStream::renderPvs(std::string_view path, const atVec3f& location) {
                       m_parent->getBlendPath().getAbsolutePath());
 
   athena::simd_floats f(location.simd);
-  m_parent->_writeStr(fmt::format(FMT_STRING("RENDERPVS {} {} {} {}"), path, f[0], f[1], f[2]));
+  m_parent->_writeCommand(fmt::format(FMT_STRING("RENDERPVS {} {} {} {}"), path, f[0], f[1], f[2]));
   m_parent->_checkOk("unable to render PVS"sv);
 
   return true;
@@ -1661,18 +2519,73 @@ bool DataStream::renderPvsLight(std::string_view path, std::string_view lightNam
     BlenderLog.report(logvisor::Fatal, FMT_STRING(_SYS_STR("{} is not an AREA blend")),
                       m_parent->getBlendPath().getAbsolutePath());
 
-  m_parent->_writeStr(fmt::format(FMT_STRING("RENDERPVSLIGHT {} {}"), path, lightName));
+  m_parent->_writeCommand(fmt::format(FMT_STRING("RENDERPVSLIGHT {} {}"), path, lightName));
   m_parent->_checkOk("unable to render PVS light"sv);
 
   return true;
 }
 
+std::size_t DataStream::renderPvsBatch(const std::vector<PvsSample>& samples,
+                                       const std::function<void(std::size_t, bool)>& onRendered) {
+  if (samples.empty())
+    return 0;
+
+  if (m_parent->getBlendType() != BlendType::Area)
+    BlenderLog.report(logvisor::Fatal, FMT_STRING(_SYS_STR("{} is not an AREA blend")),
+                      m_parent->getBlendPath().getAbsolutePath());
+
+  /* Sample list is sent as one payload: count, then per sample a path string, a source kind byte
+   * and either three floats or a light name string */
+  std::vector<uint8_t> payload;
+  const auto append = [&payload](const void* data, std::size_t len) {
+    payload.insert(payload.end(), static_cast<const uint8_t*>(data), static_cast<const uint8_t*>(data) + len);
+  };
+  const auto appendStr = [&append](std::string_view str) {
+    const auto len = static_cast<uint32_t>(str.size());
+    append(&len, 4);
+    append(str.data(), len);
+  };
+  const auto sampleCount = static_cast<uint32_t>(samples.size());
+  append(&sampleCount, 4);
+  for (const PvsSample& sample : samples) {
+    appendStr(sample.path);
+    const uint8_t isLight = std::holds_alternative<std::string>(sample.source);
+    append(&isLight, 1);
+    if (isLight) {
+      appendStr(std::get<std::string>(sample.source));
+    } else {
+      athena::simd_floats f(std::get<atVec3f>(sample.source).simd);
+      const std::array<float, 3> xyz{f[0], f[1], f[2]};
+      append(xyz.data(), sizeof(xyz));
+    }
+  }
+
+  m_parent->_writeCommand("RENDERPVSBATCH");
+  m_parent->_writeBuf(payload.data(), payload.size());
+  m_parent->_checkOk("unable to render PVS batch"sv);
+
+  std::size_t rendered = 0;
+  for (std::size_t i = 0; i < samples.size() && !m_parent->isDead(); ++i) {
+    const std::string status = m_parent->_readStdString();
+    const bool success = status == "OK";
+    if (success)
+      ++rendered;
+    else
+      BlenderLog.report(logvisor::Error, FMT_STRING("unable to render PVS {}: {}"), samples[i].path, status);
+    if (onRendered)
+      onRendered(i, success);
+  }
+
+  return rendered;
+}
+
 MapArea DataStream::compileMapArea() {
   if (m_parent->getBlendType() != BlendType::MapArea)
     BlenderLog.report(logvisor::Fatal, FMT_STRING(_SYS_STR("{} is not a MAPAREA blend")),
                       m_parent->getBlendPath().getAbsolutePath());
 
-  m_parent->_writeStr("MAPAREACOMPILE");
+  const auto cached = m_parent->_cacheReply();
+  m_parent->_writeCommand("MAPAREACOMPILE");
   m_parent->_checkOk("unable to compile map area"sv);
 
   return {*m_parent};
@@ -1683,7 +2596,8 @@ MapUniverse DataStream::compileMapUniverse() {
     BlenderLog.report(logvisor::Fatal, FMT_STRING(_SYS_STR("{} is not a MAPUNIVERSE blend")),
                       m_parent->getBlendPath().getAbsolutePath());
 
-  m_parent->_writeStr("MAPUNIVERSECOMPILE");
+  const auto cached = m_parent->_cacheReply();
+  m_parent->_writeCommand("MAPUNIVERSECOMPILE");
   m_parent->_checkOk("unable to compile map universe"sv);
 
   return {*m_parent};
@@ -1693,9 +2607,24 @@ void Connection::quitBlender() {
   if (m_blenderQuit)
     return;
   m_blenderQuit = true;
+  if (m_died) {
+    if (m_statsDump)
+      dumpCommandStats();
+#if _WIN32
+    TerminateProcess(m_pinfo.hProcess, 1);
+#else
+    kill(m_blenderProc, SIGKILL);
+    waitpid(m_blenderProc, nullptr, 0);
+#endif
+    return;
+  }
   char lineBuf[256];
+  m_openDeferred = false;
   if (m_lock) {
-    if (m_pyStreamActive) {
+    if (m_dataDeferred) {
+      m_dataDeferred = false;
+      m_dataStreamActive = false;
+    } else if (m_pyStreamActive) {
       _writeStr("PYEND");
       _readStr(lineBuf, sizeof(lineBuf));
       m_pyStreamActive = false;
@@ -1706,23 +2635,145 @@ void Connection::quitBlender() {
     }
     m_lock = false;
   }
-  _writeStr("QUIT");
+  if (m_statsDump)
+    dumpCommandStats();
+  _writeCommand("QUIT");
   _readStr(lineBuf, sizeof(lineBuf));
 #ifndef _WIN32
   waitpid(m_blenderProc, nullptr, 0);
 #endif
 }
 
+const std::unordered_map<std::string, CommandStats>& Connection::getCommandStats() {
+  _finishCommandStats();
+  return m_commandStats;
+}
+
+void Connection::resetCommandStats() {
+  m_commandStats.clear();
+  _beginCommandStats(&m_commandStats["IDLE"]);
+}
+
+void Connection::fetchBlenderProfile() {
+  if (m_lock || m_died)
+    return;
+  _writeCommand("GETPROFILE");
+  uint32_t entryCount;
+  _readValue(entryCount);
+  for (uint32_t i = 0; i < entryCount; ++i) {
+    CommandStats& stats = m_commandStats[_readStdString()];
+    uint32_t count;
+    double seconds;
+    _readValue(count);
+    _readValue(seconds);
+    stats.blenderCount = count;
+    stats.blenderTime = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::duration<double>(seconds));
+  }
+}
+
+void Connection::dumpCommandStats() {
+  fetchBlenderProfile();
+  _finishCommandStats();
+
+  std::vector<std::pair<std::string_view, const CommandStats*>> sorted;
+  sorted.reserve(m_commandStats.size());
+  for (const auto& [name, stats] : m_commandStats)
+    sorted.emplace_back(name, &stats);
+  std::sort(sorted.begin(), sorted.end(),
+            [](const auto& a, const auto& b) { return a.second->wallTime > b.second->wallTime; });
+
+  const auto ms = [](std::chrono::nanoseconds d) { return d.count() / 1000000.0; };
+  std::string table = fmt::format(FMT_STRING("{:<26} {:>7} {:>10} {:>10} {:>8} {:>10} {:>10} {:>10} {:>10}\n"),
+                                  "command", "count", "KiB out", "KiB in", "calls", "read ms", "write ms", "wall ms",
+                                  "blender ms");
+  for (const auto& [name, stats] : sorted) {
+    table += fmt::format(FMT_STRING("{:<26} {:>7} {:>10.1f} {:>10.1f} {:>8} {:>10.1f} {:>10.1f} {:>10.1f} {:>10.1f}\n"),
+                         name, stats->count, stats->bytesOut / 1024.0, stats->bytesIn / 1024.0,
+                         stats->readCalls + stats->writeCalls, ms(stats->readBlocked), ms(stats->writeBlocked),
+                         ms(stats->wallTime), ms(stats->blenderTime));
+  }
+  BlenderLog.report(logvisor::Info, FMT_STRING("blender protocol statistics:\n{}"), table);
+}
+
+uint64_t Connection::getResidentBytes() const {
+#if _WIN32
+  PROCESS_MEMORY_COUNTERS counters{};
+  if (GetProcessMemoryInfo(m_pinfo.hProcess, &counters, sizeof(counters)))
+    return counters.WorkingSetSize;
+#elif __APPLE__
+  proc_taskinfo info{};
+  if (proc_pidinfo(m_blenderProc, PROC_PIDTASKINFO, 0, &info, sizeof(info)) == int(sizeof(info)))
+    return info.pti_resident_size;
+#else
+  const std::string statmPath = fmt::format(FMT_STRING("/proc/{}/statm"), m_blenderProc);
+  if (auto fp = hecl::FopenUnique(statmPath.c_str(), "r")) {
+    unsigned long long size, resident;
+    if (std::fscanf(fp.get(), "%llu %llu", &size, &resident) == 2)
+      return resident * uint64_t(sysconf(_SC_PAGESIZE));
+  }
+#endif
+  return 0;
+}
+
+std::string Connection::recycleReason() const {
+  if (m_recyclePolicy.maxBlends && m_openedBlends >= m_recyclePolicy.maxBlends)
+    return fmt::format(FMT_STRING("opened {} blends"), m_openedBlends);
+  if (m_recyclePolicy.maxResidentBytes) {
+    const uint64_t rss = getResidentBytes();
+    if (rss >= m_recyclePolicy.maxResidentBytes)
+      return fmt::format(FMT_STRING("resident size {} MiB"), rss >> 20);
+  }
+  if (m_recyclePolicy.idleTimeout.count() && getIdleDuration() >= m_recyclePolicy.idleTimeout)
+    return fmt::format(FMT_STRING("idle for {} s"),
+                       std::chrono::duration_cast<std::chrono::seconds>(getIdleDuration()).count());
+  return {};
+}
+
+RecyclePolicy RecyclePolicy::FromEnvironment() {
+  const auto envNumber = [](const char* name) -> uint64_t {
+#if _WIN32
+    const std::wstring wname = hecl::UTF8ToWide(name);
+    const wchar_t* val = _wgetenv(wname.c_str());
+    return val ? std::wcstoull(val, nullptr, 10) : 0;
+#else
+    const char* val = getenv(name);
+    return val ? std::strtoull(val, nullptr, 10) : 0;
+#endif
+  };
+
+  RecyclePolicy policy;
+  policy.maxBlends = uint32_t(envNumber("HECL_BLENDER_RECYCLE_BLENDS"));
+  policy.maxResidentBytes = envNumber("HECL_BLENDER_RECYCLE_RSS_MB") << 20;
+  policy.idleTimeout = std::chrono::seconds(envNumber("HECL_BLENDER_RECYCLE_IDLE_SECS"));
+  return policy;
+}
+
 Connection& Connection::SharedConnection() { return SharedBlenderToken.getBlenderConnection(); }
 
 void Connection::Shutdown() { SharedBlenderToken.shutdown(); }
 
 Connection& Token::getBlenderConnection() {
-  if (!m_conn)
+  if (!m_conn) {
     m_conn = std::make_unique<Connection>(hecl::VerbosityLevel);
+    m_conn->setRecoverable(m_recoverable);
+    m_conn->setRecyclePolicy(m_recyclePolicy);
+    m_conn->setMeshThreads(m_meshThreads);
+  }
   return *m_conn;
 }
 
+bool Token::blenderDied() const { return m_conn && m_conn->isDead(); }
+
+bool Token::recoverDiedConnection() {
+  if (!blenderDied())
+    return false;
+  m_conn->quitBlender();
+  m_conn.reset();
+  if (hecl::VerbosityLevel >= 1)
+    BlenderLog.report(logvisor::Info, FMT_STRING("Respawning blender after crash"));
+  return true;
+}
+
 void Token::shutdown() {
   if (m_conn) {
     m_conn->quitBlender();
@@ -1732,6 +2783,30 @@ void Token::shutdown() {
   }
 }
 
+void Token::setMeshThreads(unsigned threads) {
+  m_meshThreads = threads;
+  if (m_conn)
+    m_conn->setMeshThreads(threads);
+}
+
+void Token::setRecyclePolicy(const RecyclePolicy& policy) {
+  m_recyclePolicy = policy;
+  if (m_conn)
+    m_conn->setRecyclePolicy(policy);
+}
+
+bool Token::recycleIfNeeded() {
+  if (!m_conn || m_conn->isDead())
+    return false;
+  const std::string reason = m_conn->recycleReason();
+  if (reason.empty())
+    return false;
+  if (hecl::VerbosityLevel >= 1)
+    BlenderLog.report(logvisor::Info, FMT_STRING("Recycling blender: {}"), reason);
+  shutdown();
+  return true;
+}
+
 Token::~Token() { shutdown(); }
 
 HMDLBuffers::HMDLBuffers(HMDLMeta&& meta, std::size_t vboSz, const std::vector<atUint32>& iboData,
@@ -1,43 +1,21 @@
 #include "MeshOptimizer.hpp"
 
 #include <algorithm>
+#include <atomic>
 #include <cfloat>
 #include <climits>
 #include <cmath>
+#include <cstring>
 #include <numeric>
+#include <optional>
+#include <thread>
 #include <unordered_set>
 
+
 namespace hecl::blender {
 
 logvisor::Module Log("MeshOptimizer");
 
-template <typename T>
-static void insert_unique_attr(std::unordered_map<T, uint32_t>& set, const T& attr) {
-  if (set.find(attr) == set.cend()) {
-    size_t sz = set.size();
-    set.insert(std::make_pair(attr, sz));
-  }
-}
-
-template <typename T>
-static std::vector<T> sort_unordered_map(const std::unordered_map<T, uint32_t>& map) {
-  struct SortableIterator {
-    typename std::unordered_map<T, uint32_t>::const_iterator it;
-    bool operator<(const SortableIterator& other) const { return it->second < other.it->second; }
-    explicit SortableIterator(typename std::unordered_map<T, uint32_t>::const_iterator i) : it(i) {}
-  };
-  std::vector<SortableIterator> to_sort;
-  to_sort.reserve(map.size());
-  for (auto I = map.cbegin(), E = map.cend(); I != E; ++I)
-    to_sort.emplace_back(I);
-  std::sort(to_sort.begin(), to_sort.end());
-  std::vector<T> ret;
-  ret.reserve(to_sort.size());
-  for (const auto& sit : to_sort)
-    ret.push_back(sit.it->first);
-  return ret;
-}
-
 static bool material_is_lightmapped(const Material& mat) {
   auto search = mat.iprops.find("retro_lightmapped");
   if (search != mat.iprops.cend())
@@ -45,90 +23,41 @@ static bool material_is_lightmapped(const Material& mat) {
   return false;
 }
 
-MeshOptimizer::Vertex::Vertex(Connection& conn) {
-  co.read(conn);
-  uint32_t skin_count;
-  conn._readValue(skin_count);
-  if (skin_count > MaxSkinEntries)
-    Log.report(logvisor::Fatal, FMT_STRING("Skin entry overflow {}/{}"), skin_count, MaxSkinEntries);
-  for (uint32_t i = 0; i < skin_count; ++i)
-    skin_ents[i] = Mesh::SkinBind(conn);
-}
-
-MeshOptimizer::Loop::Loop(Connection& conn, uint32_t color_count, uint32_t uv_count) {
-  normal.read(conn);
-  for (uint32_t i = 0; i < color_count; ++i)
-    colors[i].read(conn);
-  for (uint32_t i = 0; i < uv_count; ++i)
-    uvs[i].read(conn);
-  conn._readValue(vert);
-  conn._readValue(edge);
-  conn._readValue(face);
-  conn._readValue(link_loop_next);
-  conn._readValue(link_loop_prev);
-  conn._readValue(link_loop_radial_next);
-  conn._readValue(link_loop_radial_prev);
-}
-
-MeshOptimizer::Edge::Edge(Connection& conn) {
-  for (uint32_t i = 0; i < 2; ++i)
-    conn._readValue(verts[i]);
-  uint32_t face_count;
-  conn._readValue(face_count);
-  if (face_count > MaxLinkFaces)
-    Log.report(logvisor::Fatal, FMT_STRING("Face overflow {}/{}"), face_count, MaxLinkFaces);
-  for (uint32_t i = 0; i < face_count; ++i)
-    conn._readValue(link_faces[i]);
-  conn._readValue(is_contiguous);
-}
-
-MeshOptimizer::Face::Face(Connection& conn) {
-  normal.read(conn);
-  centroid.read(conn);
-  conn._readValue(material_index);
-  for (uint32_t i = 0; i < 3; ++i)
-    conn._readValue(loops[i]);
+template <typename T, typename Alloc>
+void MeshOptimizer::read_column(Connection& conn, std::vector<T, Alloc>& col, uint8_t width, uint32_t count) {
+  const uint32_t nItems = conn._readArrayFrame(Connection::ArrayFrameType<T>(), width);
+  if (conn.isDead()) {
+    /* Zero-fill known columns so the remaining scatters stay in bounds; the constructor discards them */
+    col.assign(size_t(count == UINT32_MAX ? 0 : count) * width, T{});
+    return;
+  }
+  if (count != UINT32_MAX && nItems != count)
+    Log.report(logvisor::Fatal, FMT_STRING("Mesh column of {} elements, expected {}"), nItems, count);
+  col.resize(size_t(nItems) * width);
+  if (!col.empty())
+    conn._readBuf(col.data(), sizeof(T) * col.size());
 }
 
 uint32_t MeshOptimizer::get_pos_idx(const Vertex& v) const {
-  auto search = b_pos.find(v.co);
-  if (search != b_pos.cend())
-    return search->second;
-  return UINT32_MAX;
+  return b_pos.find(v.co);
 }
 
 uint32_t MeshOptimizer::get_norm_idx(const Loop& l) const {
-  auto search = b_norm.find(l.normal);
-  if (search != b_norm.cend())
-    return search->second;
-  return UINT32_MAX;
+  return b_norm.find(l.normal);
 }
 
 uint32_t MeshOptimizer::get_skin_idx(const Vertex& v) const {
-  auto search = b_skin.find(v.skin_ents);
-  if (search != b_skin.cend())
-    return search->second;
-  return UINT32_MAX;
+  return b_skin.find(v.skin_ents);
 }
 
 uint32_t MeshOptimizer::get_color_idx(const Loop& l, uint32_t cidx) const {
-  auto search = b_color.find(l.colors[cidx]);
-  if (search != b_color.cend())
-    return search->second;
-  return UINT32_MAX;
+  return b_color.find(l.colors[cidx]);
 }
 
 uint32_t MeshOptimizer::get_uv_idx(const Loop& l, uint32_t uidx) const {
-  if (use_luvs && uidx == 0 && material_is_lightmapped(materials[faces[l.face].material_index])) {
-    auto search = b_luv.find(l.uvs[0]);
-    if (search != b_luv.cend())
-      return search->second;
-    return UINT32_MAX;
-  }
-  auto search = b_uv.find(l.uvs[uidx]);
-  if (search != b_uv.cend())
-    return search->second;
-  return UINT32_MAX;
+  if (use_luvs && uidx == 0 && material_is_lightmapped(materials[faces[l.face].material_index]))
+    return b_luv.find(l.uvs[0]);
+  return b_uv.find(l.uvs[uidx]);
 }
 
 bool MeshOptimizer::loops_contiguous(const Loop& la, const Loop& lb) const {
@@ -168,38 +97,32 @@ bool MeshOptimizer::splitable_edge(const Edge& e) const {
   return false;
 }
 
-void MeshOptimizer::sort_faces_by_skin_group(std::vector<uint32_t>& sfaces) const {
-  std::vector<uint32_t> faces_out;
-  faces_out.reserve(sfaces.size());
-  std::unordered_set<uint32_t> done_sg;
-  uint32_t ref_sg = UINT32_MAX;
-  while (faces_out.size() < sfaces.size()) {
-    for (uint32_t f : sfaces) {
-      bool found = false;
-      for (uint32_t l : faces[f].loops) {
-        uint32_t skin_idx = get_skin_idx(verts[loops[l].vert]);
-        if (done_sg.find(skin_idx) == done_sg.end()) {
-          ref_sg = skin_idx;
-          done_sg.insert(skin_idx);
-          found = true;
-          break;
-        }
-      }
-      if (found)
-        break;
-    }
-    for (uint32_t f : sfaces) {
-      if (std::find(faces_out.begin(), faces_out.end(), f) != faces_out.end())
-        continue;
-      for (uint32_t l : faces[f].loops) {
-        uint32_t skin_idx = get_skin_idx(verts[loops[l].vert]);
-        if (skin_idx == ref_sg) {
-          faces_out.push_back(f);
-          break;
-        }
-      }
+void MeshOptimizer::sort_faces_by_skin_group(std::pmr::vector<uint32_t>& sfaces) const {
+  /* Skin groups are taken in order of first appearance and each face goes with the earliest-taken group it
+   * touches, so a stable counting sort on that rank gives the grouping in two linear passes */
+  const auto alloc = sfaces.get_allocator();
+  const auto skin_slot = [this](uint32_t skin_idx) { return skin_idx == UINT32_MAX ? uint32_t(b_skin.size()) : skin_idx; };
+  std::pmr::vector<uint32_t> sg_rank(b_skin.size() + 1, UINT32_MAX, alloc);
+  std::pmr::vector<uint32_t> face_rank(sfaces.size(), alloc);
+  uint32_t rank_count = 0;
+  for (size_t i = 0; i < sfaces.size(); ++i) {
+    uint32_t rank = UINT32_MAX;
+    for (uint32_t l : faces[sfaces[i]].loops) {
+      uint32_t& sg = sg_rank[skin_slot(get_skin_idx(verts[loops[l].vert]))];
+      if (sg == UINT32_MAX)
+        sg = rank_count++;
+      rank = std::min(rank, sg);
     }
+    face_rank[i] = rank;
   }
+
+  std::pmr::vector<uint32_t> bucket_start(rank_count + 1, 0, alloc);
+  for (uint32_t rank : face_rank)
+    ++bucket_start[rank + 1];
+  std::partial_sum(bucket_start.begin(), bucket_start.end(), bucket_start.begin());
+  std::pmr::vector<uint32_t> faces_out(sfaces.size(), alloc);
+  for (size_t i = 0; i < sfaces.size(); ++i)
+    faces_out[bucket_start[face_rank[i]]++] = sfaces[i];
   sfaces = std::move(faces_out);
 }
 
@@ -221,8 +144,10 @@ static void Normalize(Vector3f& v) {
   v.val.simd *= athena::simd<float>(mag);
 }
 
-Mesh::Surface MeshOptimizer::generate_surface(std::vector<uint32_t>& island_faces, uint32_t mat_idx) const {
-  Mesh::Surface ret = {};
+Mesh::Surface MeshOptimizer::generate_surface(const std::pmr::vector<uint32_t>& island_faces, uint32_t mat_idx,
+                                              std::pmr::vector<uint32_t>& face_local,
+                                              std::pmr::memory_resource* scratch) const {
+  Mesh::Surface ret(scratch);
   ret.materialIdx = mat_idx;
 
   /* Centroid of surface */
@@ -250,54 +175,132 @@ Mesh::Surface MeshOptimizer::generate_surface(std::vector<uint32_t>& island_face
     ret.reflectionNormal.val.simd += faces[f].normal.val.simd;
   Normalize(ret.reflectionNormal);
 
-  /* Verts themselves */
-  uint32_t prev_loop_emit = UINT32_MAX;
-  std::vector<std::pair<std::vector<uint32_t>, std::vector<uint32_t>>> sel_lists_local;
-  sel_lists_local.reserve(loops.size());
-  while (island_faces.size()) {
-    sel_lists_local.clear();
-    for (uint32_t start_face : island_faces) {
-      for (uint32_t l : faces[start_face].loops) {
-        std::vector<uint32_t> island_local(island_faces);
-        uint32_t prev_loop = loops[l].link_loop_next;
-        uint32_t loop = loops[prev_loop].link_loop_next;
-        std::vector<uint32_t> sel_list;
-        sel_list.reserve(64);
-        sel_list.push_back(l);
-        sel_list.push_back(prev_loop);
-        sel_list.push_back(loop);
-        island_local.erase(std::find(island_local.begin(), island_local.end(), start_face));
-        while (true) {
-          const Edge& prev_edge = edges[loops[prev_loop].edge];
-          if (!prev_edge.is_contiguous || prev_edge.tag)
-            break;
-          std::tie(loop, prev_loop) = strip_next_loop(prev_loop, sel_list.size());
-          uint32_t face = loops[loop].face;
-          auto search = std::find(island_local.begin(), island_local.end(), face);
-          if (search == island_local.end())
-            break;
-          sel_list.push_back(loop);
-          island_local.erase(search);
+  /* Local face slots in the caller's mesh-wide table (all UINT32_MAX between islands) */
+  const auto face_count = uint32_t(island_faces.size());
+  for (uint32_t i = 0; i < face_count; ++i)
+    face_local[island_faces[i]] = i;
+  const auto slot_of = [&](uint32_t loop) {
+    const uint32_t f = face_local[loops[loop].face];
+    if (f == UINT32_MAX)
+      return UINT32_MAX;
+    const auto& fl = faces[island_faces[f]].loops;
+    return f * 3 + (fl[0] == loop ? 0 : fl[1] == loop ? 1 : 2);
+  };
+
+  /* Strip steps between corner slots (face * 3 + corner) for either parity of the strip length,
+   * as next loop slot and next previous-loop slot; walks then only touch this table */
+  std::pmr::vector<std::array<uint32_t, 4>> step(size_t(face_count) * 3, scratch);
+  for (uint32_t i = 0; i < face_count; ++i) {
+    for (uint32_t k = 0; k < 3; ++k) {
+      const uint32_t prev_loop = faces[island_faces[i]].loops[k];
+      auto& st = step[i * 3 + k];
+      st.fill(UINT32_MAX);
+      const Edge& prev_edge = edges[loops[prev_loop].edge];
+      if (!prev_edge.is_contiguous || prev_edge.tag)
+        continue;
+      for (uint32_t parity = 0; parity < 2; ++parity) {
+        const auto [loop, next_prev] = strip_next_loop(prev_loop, parity);
+        if (const uint32_t slot = slot_of(loop); slot != UINT32_MAX) {
+          st[parity * 2] = slot;
+          st[parity * 2 + 1] = slot_of(next_prev);
         }
-        sel_lists_local.emplace_back(std::move(sel_list), std::move(island_local));
       }
     }
-    uint32_t max_count = 0;
-    const std::vector<uint32_t>* max_sl = nullptr;
-    const std::vector<uint32_t>* max_island_faces = nullptr;
-    for (const auto& sl : sel_lists_local) {
-      if (sl.first.size() > max_count) {
-        max_count = sl.first.size();
-        max_sl = &sl.first;
-        max_island_faces = &sl.second;
-      }
+  }
+
+  /* Walks a strip from one corner of the start face, marking faces with the trial stamp */
+  std::pmr::vector<uint8_t> used(face_count, 0, scratch);
+  std::pmr::vector<uint32_t> trial(face_count, 0, scratch);
+  uint32_t trial_id = 0;
+  const auto walk_strip = [&](uint32_t start_face, uint32_t l, std::pmr::vector<uint32_t>& sel_list) {
+    ++trial_id;
+    trial[start_face] = trial_id;
+    const uint32_t prev_loop = loops[l].link_loop_next;
+    sel_list.clear();
+    sel_list.push_back(l);
+    sel_list.push_back(prev_loop);
+    sel_list.push_back(loops[prev_loop].link_loop_next);
+    for (uint32_t prev = slot_of(prev_loop);;) {
+      const uint32_t parity = sel_list.size() & 1;
+      const uint32_t next = step[prev][parity * 2];
+      if (next == UINT32_MAX || used[next / 3] || trial[next / 3] == trial_id)
+        break;
+      sel_list.push_back(faces[island_faces[next / 3]].loops[next % 3]);
+      trial[next / 3] = trial_id;
+      prev = step[prev][parity * 2 + 1];
+    }
+  };
+
+  /* Each walk state (slot, parity) has at most one successor, so the steps reachable from every state
+   * resolve in one pass: chains back to front, cycles capped at their length. Revisited faces are
+   * ignored, which makes these upper bounds on the strip lengths */
+  std::pmr::vector<uint32_t> reach(step.size() * 2, UINT32_MAX, scratch);
+  std::pmr::vector<uint32_t> path(scratch);
+  for (uint32_t s0 = 0; s0 < reach.size(); ++s0) {
+    path.clear();
+    uint32_t s = s0;
+    while (s != UINT32_MAX && reach[s] == UINT32_MAX) {
+      reach[s] = UINT32_MAX - 1;
+      path.push_back(s);
+      const uint32_t parity = s & 1;
+      s = step[s / 2][parity * 2] == UINT32_MAX ? UINT32_MAX : step[s / 2][parity * 2 + 1] * 2 + (parity ^ 1);
+    }
+    size_t end = path.size();
+    uint32_t succ_reach = 0;
+    if (s == UINT32_MAX) {
+      reach[path[--end]] = 0;
+    } else if (reach[s] == UINT32_MAX - 1) {
+      const size_t pos = std::find(path.begin(), path.end(), s) - path.begin();
+      succ_reach = uint32_t(end - pos);
+      for (size_t i = pos; i < end; ++i)
+        reach[path[i]] = succ_reach;
+      end = pos;
+    } else {
+      succ_reach = reach[s];
+    }
+    while (end)
+      succ_reach = reach[path[--end]] = succ_reach + 1;
+  }
+
+  /* Longest strip first, like an exhaustive search over every face corner. Queued lengths are upper
+   * bounds that only shrink as faces are used, so a popped start is walked and taken only if its
+   * length still holds; ties go to the earliest face and corner */
+  using StripStart = std::pair<uint32_t, uint32_t>; /* Strip length bound, inverted corner slot */
+  std::pmr::vector<StripStart> starts(scratch);
+  starts.reserve(step.size());
+  for (uint32_t i = 0; i < face_count; ++i)
+    for (uint32_t k = 0; k < 3; ++k)
+      starts.emplace_back(3 + reach[slot_of(loops[faces[island_faces[i]].loops[k]].link_loop_next) * 2 + 1],
+                          ~(i * 3 + k));
+  std::make_heap(starts.begin(), starts.end());
+
+  /* Verts themselves */
+  uint32_t prev_loop_emit = UINT32_MAX;
+  std::pmr::vector<uint32_t> strip(scratch);
+  strip.reserve(64);
+  for (uint32_t remaining = face_count; remaining;) {
+    assert(!starts.empty() && "Strip queue exhausted with faces remaining");
+    std::pop_heap(starts.begin(), starts.end());
+    const auto [length, inv_slot] = starts.back();
+    starts.pop_back();
+    const uint32_t start_face = ~inv_slot / 3;
+    if (used[start_face])
+      continue;
+    walk_strip(start_face, faces[island_faces[start_face]].loops[~inv_slot % 3], strip);
+    if (strip.size() != length) {
+      starts.emplace_back(uint32_t(strip.size()), inv_slot);
+      std::push_heap(starts.begin(), starts.end());
+      continue;
+    }
+
+    for (size_t i = 2; i < strip.size(); ++i) {
+      used[face_local[loops[strip[i]].face]] = 1;
+      --remaining;
     }
-    assert(max_island_faces && "Should not be null");
-    assert(max_island_faces->size() < island_faces.size() && "Infinite loop condition");
-    island_faces = std::move(*max_island_faces);
+
     if (prev_loop_emit != UINT32_MAX)
       ret.verts.emplace_back();
-    for (uint32_t loop : *max_sl) {
+    for (uint32_t loop : strip) {
       ret.verts.emplace_back();
       const auto& l = loops[loop];
       auto& vert = ret.verts.back();
@@ -312,20 +315,22 @@ Mesh::Surface MeshOptimizer::generate_surface(std::vector<uint32_t>& island_face
     }
   }
 
+  for (uint32_t f : island_faces)
+    face_local[f] = UINT32_MAX;
   return ret;
 }
 
-void MeshOptimizer::optimize(Mesh& mesh, int max_skin_banks) const {
+void MeshOptimizer::optimize(Mesh& mesh, int max_skin_banks, unsigned max_threads) const {
   mesh.topology = HMDLTopology::TriStrips;
 
-  mesh.pos = sort_unordered_map(b_pos);
-  mesh.norm = sort_unordered_map(b_norm);
+  mesh.pos.assign(b_pos.values().cbegin(), b_pos.values().cend());
+  mesh.norm.assign(b_norm.values().cbegin(), b_norm.values().cend());
   mesh.colorLayerCount = color_count;
-  mesh.color = sort_unordered_map(b_color);
+  mesh.color.assign(b_color.values().cbegin(), b_color.values().cend());
   mesh.uvLayerCount = uv_count;
-  mesh.uv = sort_unordered_map(b_uv);
-  mesh.luv = sort_unordered_map(b_luv);
-  mesh.skins = sort_unordered_map(b_skin);
+  mesh.uv.assign(b_uv.values().cbegin(), b_uv.values().cend());
+  mesh.luv.assign(b_luv.values().cbegin(), b_luv.values().cend());
+  mesh.skins.assign(b_skin.values().cbegin(), b_skin.values().cend());
 
   /* Sort materials by pass index */
   std::vector<uint32_t> sorted_material_idxs(materials.size());
@@ -333,14 +338,14 @@ void MeshOptimizer::optimize(Mesh& mesh, int max_skin_banks) const {
   std::sort(sorted_material_idxs.begin(), sorted_material_idxs.end(),
   [this](uint32_t a, uint32_t b) { return materials[a].passIndex < materials[b].passIndex; });
 
-  /* Generate island surfaces */
-  std::vector<uint32_t> mat_faces_rem, the_list;
+  /* Partition each material's faces into island surfaces; skin bank splits depend on face order */
+  std::pmr::unsynchronized_pool_resource scratch;
+  std::pmr::vector<uint32_t> mat_faces_rem(&scratch);
+  std::pmr::vector<std::pair<uint32_t, std::pmr::vector<uint32_t>>> islands(&scratch);
   mat_faces_rem.reserve(faces.size());
-  the_list.reserve(faces.size());
   std::unordered_set<uint32_t> skin_slot_set;
   skin_slot_set.reserve(b_skin.size());
   for (uint32_t mat_idx : sorted_material_idxs) {
-    const auto& mat = materials[mat_idx];
     mat_faces_rem.clear();
     for (auto B = faces.begin(), I = B, E = faces.end(); I != E; ++I) {
       if (I->material_index == mat_idx)
@@ -350,7 +355,7 @@ void MeshOptimizer::optimize(Mesh& mesh, int max_skin_banks) const {
       sort_faces_by_skin_group(mat_faces_rem);
     size_t rem_count = mat_faces_rem.size();
     while (rem_count) {
-      the_list.clear();
+      auto& the_list = islands.emplace_back(mat_idx, std::pmr::vector<uint32_t>(&scratch)).second;
       skin_slot_set.clear();
       for (uint32_t& f : mat_faces_rem) {
         if (f == UINT32_MAX)
@@ -375,12 +380,46 @@ void MeshOptimizer::optimize(Mesh& mesh, int max_skin_banks) const {
         f = UINT32_MAX;
         --rem_count;
       }
-      mesh.surfaces.push_back(generate_surface(the_list, mat_idx));
     }
   }
+
+  /* Surfaces only read the finished attribute pools, so they are built concurrently into fixed slots,
+   * largest islands first. Each worker builds in its own pool; the mesh's arena is not thread-safe,
+   * so surfaces are copied into it in island order once all workers are done */
+  size_t worker_count = max_threads ? max_threads : std::thread::hardware_concurrency();
+  if (faces.size() < ParallelSurfaceFaces)
+    worker_count = 1;
+  worker_count = std::clamp(worker_count, size_t(1), islands.size() ? islands.size() : size_t(1));
+  std::vector<std::pmr::unsynchronized_pool_resource> pools(worker_count - 1);
+  std::vector<std::optional<Mesh::Surface>> built(islands.size());
+  std::vector<uint32_t> order(islands.size());
+  std::iota(order.begin(), order.end(), 0);
+  std::stable_sort(order.begin(), order.end(),
+                   [&](uint32_t a, uint32_t b) { return islands[a].second.size() > islands[b].second.size(); });
+  std::atomic_size_t next_island = 0;
+  const auto build_surfaces = [&](std::pmr::memory_resource* pool) {
+    std::pmr::vector<uint32_t> face_local(faces.size(), UINT32_MAX, pool);
+    for (size_t i; (i = next_island++) < order.size();) {
+      const auto& [mat_idx, island] = islands[order[i]];
+      built[order[i]].emplace(generate_surface(island, mat_idx, face_local, pool));
+    }
+  };
+
+  std::vector<std::thread> workers;
+  workers.reserve(worker_count - 1);
+  for (size_t i = 1; i < worker_count; ++i)
+    workers.emplace_back([&build_surfaces, pool = &pools[i - 1]]() { build_surfaces(pool); });
+  build_surfaces(&scratch);
+  for (auto& worker : workers)
+    worker.join();
+
+  std::pmr::memory_resource* res = mesh.surfaces.get_allocator().resource();
+  mesh.surfaces.reserve(mesh.surfaces.size() + built.size());
+  for (const auto& surf : built)
+    mesh.surfaces.emplace_back(res) = *surf;
 }
 
-MeshOptimizer::MeshOptimizer(Connection& conn, const std::vector<Material>& materials, bool use_luvs)
+MeshOptimizer::MeshOptimizer(Connection& conn, const std::pmr::vector<Material>& materials, bool use_luvs)
 : materials(materials), use_luvs(use_luvs) {
   conn._readValue(color_count);
   if (color_count > MaxColorLayers)
@@ -389,48 +428,137 @@ MeshOptimizer::MeshOptimizer(Connection& conn, const std::vector<Material>& mate
   if (uv_count > MaxUVLayers)
     Log.report(logvisor::Fatal, FMT_STRING("UV layer overflow {}/{}"), uv_count, MaxUVLayers);
 
-  /* Simultaneously load topology objects and build unique mapping indices */
+  /* Attributes arrive as one array frame per column; scatter each into the topology objects */
+  std::vector<float> fcol;
+  std::vector<uint32_t> icol;
+  std::vector<uint32_t> counts;
+
+  read_column(conn, fcol, 3, UINT32_MAX);
+  const auto vert_count = uint32_t(fcol.size() / 3);
+  verts.resize(vert_count);
+  for (uint32_t i = 0; i < vert_count; ++i)
+    std::memcpy(static_cast<void*>(&verts[i].co.val), &fcol[i * 3], sizeof(float) * 3);
+
+  read_column(conn, counts, 1, vert_count);
+  read_column(conn, icol, 1, UINT32_MAX);
+  read_column(conn, fcol, 1, uint32_t(icol.size()));
+  for (uint32_t i = 0, s = 0; i < vert_count; ++i) {
+    if (counts[i] > MaxSkinEntries)
+      Log.report(logvisor::Fatal, FMT_STRING("Skin entry overflow {}/{}"), counts[i], MaxSkinEntries);
+    if (s + counts[i] > icol.size())
+      Log.report(logvisor::Fatal, FMT_STRING("Skin entries exceed {}"), icol.size());
+    for (uint32_t j = 0; j < counts[i]; ++j, ++s) {
+      verts[i].skin_ents[j].vg_idx = icol[s];
+      verts[i].skin_ents[j].weight = fcol[s];
+    }
+  }
+
+  read_column(conn, fcol, 3, UINT32_MAX);
+  const auto loop_count = uint32_t(fcol.size() / 3);
+  loops.resize(loop_count);
+  for (uint32_t i = 0; i < loop_count; ++i)
+    std::memcpy(static_cast<void*>(&loops[i].normal.val), &fcol[i * 3], sizeof(float) * 3);
+  for (uint32_t c = 0; c < color_count; ++c) {
+    read_column(conn, fcol, 3, loop_count);
+    for (uint32_t i = 0; i < loop_count; ++i)
+      std::memcpy(static_cast<void*>(&loops[i].colors[c].val), &fcol[i * 3], sizeof(float) * 3);
+  }
+  for (uint32_t u = 0; u < uv_count; ++u) {
+    read_column(conn, fcol, 2, loop_count);
+    for (uint32_t i = 0; i < loop_count; ++i)
+      std::memcpy(static_cast<void*>(&loops[i].uvs[u].val), &fcol[i * 2], sizeof(float) * 2);
+  }
+  read_column(conn, icol, 7, loop_count);
+  for (uint32_t i = 0; i < loop_count; ++i) {
+    const uint32_t* topo = &icol[i * 7];
+    Loop& l = loops[i];
+    l.vert = topo[0];
+    l.edge = topo[1];
+    l.face = topo[2];
+    l.link_loop_next = topo[3];
+    l.link_loop_prev = topo[4];
+    l.link_loop_radial_next = topo[5];
+    l.link_loop_radial_prev = topo[6];
+  }
+
+  read_column(conn, icol, 2, UINT32_MAX);
+  const auto edge_count = uint32_t(icol.size() / 2);
+  edges.resize(edge_count);
+  for (uint32_t i = 0; i < edge_count; ++i) {
+    edges[i].verts[0] = icol[i * 2];
+    edges[i].verts[1] = icol[i * 2 + 1];
+  }
+  read_column(conn, counts, 1, edge_count);
+  read_column(conn, icol, 1, UINT32_MAX);
+  for (uint32_t i = 0, s = 0; i < edge_count; ++i) {
+    if (counts[i] > Edge::MaxLinkFaces)
+      Log.report(logvisor::Fatal, FMT_STRING("Face overflow {}/{}"), counts[i], Edge::MaxLinkFaces);
+    if (s + counts[i] > icol.size())
+      Log.report(logvisor::Fatal, FMT_STRING("Edge faces exceed {}"), icol.size());
+    for (uint32_t j = 0; j < counts[i]; ++j, ++s)
+      edges[i].link_faces[j] = icol[s];
+  }
+  std::vector<uint8_t> contiguous;
+  read_column(conn, contiguous, 1, edge_count);
+  for (uint32_t i = 0; i < edge_count; ++i)
+    edges[i].is_contiguous = contiguous[i] != 0;
+
+  read_column(conn, fcol, 3, UINT32_MAX);
+  const auto face_count = uint32_t(fcol.size() / 3);
+  faces.resize(face_count);
+  for (uint32_t i = 0; i < face_count; ++i)
+    std::memcpy(static_cast<void*>(&faces[i].normal.val), &fcol[i * 3], sizeof(float) * 3);
+  read_column(conn, fcol, 3, face_count);
+  for (uint32_t i = 0; i < face_count; ++i)
+    std::memcpy(static_cast<void*>(&faces[i].centroid.val), &fcol[i * 3], sizeof(float) * 3);
+  read_column(conn, icol, 1, face_count);
+  for (uint32_t i = 0; i < face_count; ++i)
+    faces[i].material_index = icol[i];
+  read_column(conn, icol, 3, face_count);
+  for (uint32_t i = 0; i < face_count; ++i)
+    for (uint32_t j = 0; j < 3; ++j)
+      faces[i].loops[j] = icol[i * 3 + j];
+
+  /* Blender died mid-stream; leave an empty mesh for the caller's recovery path */
+  if (conn.isDead()) {
+    verts.clear();
+    loops.clear();
+    edges.clear();
+    faces.clear();
+    return;
+  }
 
-  uint32_t vert_count;
-  conn._readValue(vert_count);
-  verts.reserve(vert_count);
+  /* Build unique mapping indices; lightmap classification needs faces, so this follows the full read */
   b_pos.reserve(vert_count);
-  b_skin.reserve(vert_count * 4);
-  for (uint32_t i = 0; i < vert_count; ++i) {
-    verts.emplace_back(conn);
-    insert_unique_attr(b_pos, verts.back().co);
-    if (verts.back().skin_ents[0].valid())
-      insert_unique_attr(b_skin, verts.back().skin_ents);
+  b_skin.reserve(vert_count);
+  for (const auto& v : verts) {
+    b_pos.insert(v.co);
+    if (v.skin_ents[0].valid())
+      b_skin.insert(v.skin_ents);
   }
 
-  uint32_t loop_count;
-  conn._readValue(loop_count);
-  loops.reserve(loop_count);
   b_norm.reserve(loop_count);
+  b_color.reserve(loop_count * color_count + 1);
   if (use_luvs) {
     b_uv.reserve(std::max(int(loop_count) - 1, 0) * uv_count);
     b_luv.reserve(loop_count);
   } else {
     b_uv.reserve(loop_count * uv_count);
   }
-  for (uint32_t i = 0; i < loop_count; ++i) {
-    loops.emplace_back(conn, color_count, uv_count);
-    insert_unique_attr(b_norm, loops.back().normal);
-    for (const auto& c : loops.back().colors)
-      insert_unique_attr(b_color, c);
-    if (use_luvs && material_is_lightmapped(materials[faces[loops.back().face].material_index])) {
-      insert_unique_attr(b_luv, loops.back().uvs[0]);
-      for (auto I = std::begin(loops.back().uvs) + 1, E = std::end(loops.back().uvs); I != E; ++I)
-        insert_unique_attr(b_uv, *I);
+  for (const auto& l : loops) {
+    b_norm.insert(l.normal);
+    for (const auto& c : l.colors)
+      b_color.insert(c);
+    if (use_luvs && material_is_lightmapped(materials[faces[l.face].material_index])) {
+      b_luv.insert(l.uvs[0]);
+      for (auto I = std::begin(l.uvs) + 1, E = std::end(l.uvs); I != E; ++I)
+        b_uv.insert(*I);
     } else {
-      for (const auto& c : loops.back().uvs)
-        insert_unique_attr(b_uv, c);
+      for (const auto& c : l.uvs)
+        b_uv.insert(c);
     }
   }
 
-  conn._readVector(edges);
-  conn._readVector(faces);
-
   /* Cache edges that should block tristrip traversal */
   for (auto& e : edges)
     e.tag = splitable_edge(e);
@@ -4,7 +4,8 @@
 #include <array>
 #include <cstddef>
 #include <cstdint>
-#include <unordered_map>
+#include <cstring>
+#include <memory_resource>
 #include <utility>
 #include <vector>
 
@@ -38,23 +39,117 @@ public:
   size_t size() const { return end() - begin(); }
 };
 
+/* Whole-value attribute hashes; -0 folds into +0 so hashing agrees with float equality */
+inline uint64_t AttrMix(uint64_t a, uint64_t b) {
+  uint64_t h = a ^ (b * 0x9E3779B97F4A7C15ULL);
+  h ^= h >> 33;
+  h *= 0xFF51AFD7ED558CCDULL;
+  h ^= h >> 33;
+  h *= 0xC4CEB9FE1A85EC53ULL;
+  return h ^ (h >> 33);
+}
+inline uint64_t AttrBits(float a, float b) {
+  const float pair[2] = {a == 0.f ? 0.f : a, b == 0.f ? 0.f : b};
+  uint64_t bits;
+  std::memcpy(&bits, pair, sizeof(bits));
+  return bits;
+}
+inline uint64_t AttrHash(const Vector2f& v) { return AttrMix(AttrBits(v.val.simd[0], v.val.simd[1]), 0); }
+inline uint64_t AttrHash(const Vector3f& v) {
+  return AttrMix(AttrBits(v.val.simd[0], v.val.simd[1]), AttrBits(v.val.simd[2], 0.f));
+}
+template <size_t S>
+uint64_t AttrHash(const std::array<Mesh::SkinBind, S>& skin) {
+  uint64_t h = 0;
+  for (const auto& bind : skin) {
+    if (!bind.valid())
+      break;
+    uint32_t weight;
+    const float w = bind.weight == 0.f ? 0.f : bind.weight;
+    std::memcpy(&weight, &w, sizeof(weight));
+    h = AttrMix(h, uint64_t(bind.vg_idx) << 32 | weight);
+  }
+  return h;
+}
+
+/* Insertion-ordered dedup table: values are stored densely in first-insertion order and
+ * a power-of-two, linearly probed slot array maps each hash to its value index */
+template <typename T>
+class AttrTable {
+  std::pmr::vector<T> m_values;
+  std::pmr::vector<uint32_t> m_slots; /* UINT32_MAX marks an empty slot */
+
+  void rehash(size_t slot_count) {
+    m_slots.assign(slot_count, UINT32_MAX);
+    const size_t mask = slot_count - 1;
+    for (uint32_t i = 0; i < m_values.size(); ++i) {
+      size_t slot = AttrHash(m_values[i]) & mask;
+      while (m_slots[slot] != UINT32_MAX)
+        slot = (slot + 1) & mask;
+      m_slots[slot] = i;
+    }
+  }
+
+public:
+  explicit AttrTable(std::pmr::memory_resource* res) : m_values(res), m_slots(res) {}
+  void reserve(size_t count) {
+    m_values.reserve(count);
+    size_t slot_count = 16;
+    while (slot_count < count * 2)
+      slot_count *= 2;
+    if (slot_count > m_slots.size())
+      rehash(slot_count);
+  }
+  uint32_t insert(const T& val) {
+    if ((m_values.size() + 1) * 2 > m_slots.size())
+      rehash(std::max(size_t(16), m_slots.size() * 2));
+    const size_t mask = m_slots.size() - 1;
+    for (size_t slot = AttrHash(val) & mask;; slot = (slot + 1) & mask) {
+      uint32_t& idx = m_slots[slot];
+      if (idx == UINT32_MAX) {
+        idx = uint32_t(m_values.size());
+        m_values.push_back(val);
+        return idx;
+      }
+      if (m_values[idx] == val)
+        return idx;
+    }
+  }
+  uint32_t find(const T& val) const {
+    if (m_slots.empty())
+      return UINT32_MAX;
+    const size_t mask = m_slots.size() - 1;
+    for (size_t slot = AttrHash(val) & mask;; slot = (slot + 1) & mask) {
+      const uint32_t idx = m_slots[slot];
+      if (idx == UINT32_MAX || m_values[idx] == val)
+        return idx;
+    }
+  }
+  size_t size() const { return m_values.size(); }
+  const std::pmr::vector<T>& values() const { return m_values; }
+};
+
 class MeshOptimizer {
   static constexpr size_t MaxColorLayers = Mesh::MaxColorLayers;
   static constexpr size_t MaxUVLayers = Mesh::MaxUVLayers;
   static constexpr size_t MaxSkinEntries = Mesh::MaxSkinEntries;
+  /* Meshes smaller than this build their surfaces on the calling thread */
+  static constexpr size_t ParallelSurfaceFaces = 4096;
 
-  const std::vector<Material>& materials;
+  const std::pmr::vector<Material>& materials;
   bool use_luvs;
 
   uint32_t color_count;
   uint32_t uv_count;
 
+  /* Backs all topology and dedup storage; released in one go when the optimizer is destroyed */
+  std::pmr::monotonic_buffer_resource arena;
+
   struct Vertex {
     Vector3f co = {};
     std::array<Mesh::SkinBind, MaxSkinEntries> skin_ents = {};
-    explicit Vertex(Connection& conn);
   };
-  std::vector<Vertex> verts;
+  std::pmr::vector<Vertex> verts{&arena};
 
   struct Loop {
     Vector3f normal = {};
@@ -67,9 +162,8 @@ class MeshOptimizer {
     uint32_t link_loop_prev = UINT32_MAX;
     uint32_t link_loop_radial_next = UINT32_MAX;
     uint32_t link_loop_radial_prev = UINT32_MAX;
-    explicit Loop(Connection& conn, uint32_t color_count, uint32_t uv_count);
   };
-  std::vector<Loop> loops;
+  std::pmr::vector<Loop> loops{&arena};
 
   struct Edge {
     static constexpr size_t MaxLinkFaces = 8;
@@ -77,41 +171,44 @@ class MeshOptimizer {
     IndexArray<MaxLinkFaces> link_faces;
     bool is_contiguous = false;
     bool tag = false;
-    explicit Edge(Connection& conn);
   };
-  std::vector<Edge> edges;
+  std::pmr::vector<Edge> edges{&arena};
 
   struct Face {
     Vector3f normal = {};
     Vector3f centroid = {};
     uint32_t material_index = UINT32_MAX;
     IndexArray<3> loops;
-    explicit Face(Connection& conn);
   };
-  std::vector<Face> faces;
+  std::pmr::vector<Face> faces{&arena};
+
+  AttrTable<Vector3f> b_pos{&arena};
+  AttrTable<Vector3f> b_norm{&arena};
+  AttrTable<std::array<Mesh::SkinBind, MaxSkinEntries>> b_skin{&arena};
+  AttrTable<Vector3f> b_color{&arena};
+  AttrTable<Vector2f> b_uv{&arena};
+  AttrTable<Vector2f> b_luv{&arena};
 
-  std::unordered_map<Vector3f, uint32_t> b_pos;
-  std::unordered_map<Vector3f, uint32_t> b_norm;
-  std::unordered_map<std::array<Mesh::SkinBind, MaxSkinEntries>, uint32_t> b_skin;
-  std::unordered_map<Vector3f, uint32_t> b_color;
-  std::unordered_map<Vector2f, uint32_t> b_uv;
-  std::unordered_map<Vector2f, uint32_t> b_luv;
+  template <typename T, typename Alloc>
+  static void read_column(Connection& conn, std::vector<T, Alloc>& col, uint8_t width, uint32_t count);
 
   uint32_t get_pos_idx(const Vertex& v) const;
   uint32_t get_norm_idx(const Loop& l) const;
   uint32_t get_skin_idx(const Vertex& v) const;
   uint32_t get_color_idx(const Loop& l, uint32_t cidx) const;
   uint32_t get_uv_idx(const Loop& l, uint32_t uidx) const;
-  void sort_faces_by_skin_group(std::vector<uint32_t>& faces) const;
+  void sort_faces_by_skin_group(std::pmr::vector<uint32_t>& faces) const;
   std::pair<uint32_t, uint32_t> strip_next_loop(uint32_t prev_loop, uint32_t out_count) const;
 
   bool loops_contiguous(const Loop& la, const Loop& lb) const;
   bool splitable_edge(const Edge& e) const;
-  Mesh::Surface generate_surface(std::vector<uint32_t>& island_faces, uint32_t mat_idx) const;
+  Mesh::Surface generate_surface(const std::pmr::vector<uint32_t>& island_faces, uint32_t mat_idx,
+                                std::pmr::vector<uint32_t>& face_local, std::pmr::memory_resource* scratch) const;
 
 public:
-  explicit MeshOptimizer(Connection& conn, const std::vector<Material>& materials, bool use_luvs);
-  void optimize(Mesh& mesh, int max_skin_banks) const;
+  explicit MeshOptimizer(Connection& conn, const std::pmr::vector<Material>& materials, bool use_luvs);
+  /** max_threads bounds the surface builders including the caller; 0 allows one per CPU */
+  void optimize(Mesh& mesh, int max_skin_banks, unsigned max_threads) const;
 };
 
 }
\ No newline at end of file
@@ -1,17 +1,69 @@
 #include "hecl/Blender/SDNARead.hpp"
 
+#include <algorithm>
 #include <cstring>
+#include <limits>
 #include <string>
 
 #include "hecl/hecl.hpp"
+#include "hecl/Database.hpp"
 
-#include <athena/FileReader.hpp>
 #include <athena/MemoryReader.hpp>
 
+#ifndef _WIN32
+#include <sys/mman.h>
+#endif
+
 #include <zlib.h>
+#if HECL_HAS_ZSTD
+#include <zstd.h>
+#endif
 
 namespace hecl::blender {
 
+namespace {
+std::string_view FieldBaseName(std::string_view name) { return name.substr(0, name.find('[')); }
+
+template <typename GetName>
+std::vector<SDNABlock::NameSlot> BuildNameIndex(size_t count, GetName getName) {
+  size_t capacity = 16;
+  while (capacity < count * 2)
+    capacity *= 2;
+  std::vector<SDNABlock::NameSlot> index(capacity);
+  for (size_t i = 0; i < count; ++i) {
+    const std::string_view name = getName(i);
+    const uint32_t hash = Hash(name).val32();
+    for (size_t slot = hash & (capacity - 1);; slot = (slot + 1) & (capacity - 1)) {
+      SDNABlock::NameSlot& s = index[slot];
+      if (s.idx == UINT32_MAX) {
+        s.hash = hash;
+        s.idx = uint32_t(i);
+        break;
+      }
+      /* First declaration wins, matching a front-to-back search */
+      if (s.hash == hash && getName(s.idx) == name)
+        break;
+    }
+  }
+  return index;
+}
+
+template <typename GetName>
+uint32_t FindName(const std::vector<SDNABlock::NameSlot>& index, std::string_view name, GetName getName) {
+  if (index.empty())
+    return UINT32_MAX;
+  const uint32_t hash = Hash(name).val32();
+  const size_t mask = index.size() - 1;
+  for (size_t slot = hash & mask;; slot = (slot + 1) & mask) {
+    const SDNABlock::NameSlot& s = index[slot];
+    if (s.idx == UINT32_MAX)
+      return UINT32_MAX;
+    if (s.hash == hash && getName(s.idx) == name)
+      return s.idx;
+  }
+}
+} // namespace
+
 void SDNABlock::SDNAStruct::computeOffsets(const SDNABlock& block) {
   atUint32 offset = 0;
   for (SDNAField& f : fields) {
@@ -30,161 +82,829 @@ void SDNABlock::SDNAStruct::computeOffsets(const SDNABlock& block) {
 }
 
 const SDNABlock::SDNAStruct::SDNAField* SDNABlock::SDNAStruct::lookupField(const SDNABlock& block,
-                                                                           const char* n) const {
-  for (const SDNAField& field : fields) {
-    const auto& name = block.names[field.name];
-    auto bracket = name.find('[');
-    if (bracket != std::string::npos) {
-      if (!name.compare(0, bracket, n))
-        return &field;
-    } else if (name == n)
-      return &field;
+                                                                           std::string_view n) const {
+  const uint32_t idx = FindName(fieldIndex, n, [&](uint32_t i) { return FieldBaseName(block.names[fields[i].name]); });
+  return idx != UINT32_MAX ? &fields[idx] : nullptr;
+}
+
+void SDNABlock::buildIndexes() {
+  for (SDNAStruct& strc : strcs) {
+    strc.computeOffsets(*this);
+    strc.fieldIndex = BuildNameIndex(
+        strc.fields.size(), [&](uint32_t i) { return FieldBaseName(names[strc.fields[i].name]); });
   }
-  return nullptr;
+  structIndex = BuildNameIndex(strcs.size(), [this](uint32_t i) { return std::string_view(types[strcs[i].type]); });
 }
 
-const SDNABlock::SDNAStruct* SDNABlock::lookupStruct(const char* n, atUint32& idx) const {
-  idx = 0;
-  for (const SDNAStruct& strc : strcs) {
-    const auto& name = types[strc.type];
-    if (name == n)
-      return &strc;
-    ++idx;
+const SDNABlock::SDNAStruct* SDNABlock::lookupStruct(std::string_view n, atUint32& idx) const {
+  idx = FindName(structIndex, n, [this](uint32_t i) { return std::string_view(types[strcs[i].type]); });
+  return idx != UINT32_MAX ? &strcs[idx] : nullptr;
+}
+
+SDNABlock::FieldRef SDNABlock::resolveField(std::string_view strct, std::string_view field) const {
+  FieldRef ret;
+  atUint32 idx;
+  if (const SDNAStruct* s = lookupStruct(strct, idx)) {
+    if (const auto* f = s->lookupField(*this, field)) {
+      ret.sdnaIdx = idx;
+      ret.offset = f->offset;
+    }
   }
-  return nullptr;
+  return ret;
 }
 
 void SDNARead::enumerate(const std::function<bool(const FileBlock& block, athena::io::MemoryReader& r)>& func) const {
-  athena::io::MemoryReader r(m_data.data(), m_data.size());
-  r.seek(12);
-  while (r.position() < r.length()) {
-    FileBlock block;
-    block.read(r);
-    if (block.type == FOURCC('ENDB'))
+  for (const BlockEntry& block : m_blocks) {
+    if (block.offset == NotResident)
+      continue;
+    athena::io::MemoryReader r(blockData(block), block.header.size);
+    if (!func(block.header, r))
       break;
-    athena::io::MemoryReader r2(m_data.data() + r.position(), block.size);
-    if (!func(block, r2))
-      break;
-    r.seek(block.size);
   }
 }
 
-SDNARead::SDNARead(SystemStringView path) {
-  athena::io::FileReader r(path);
-  if (r.hasError())
+bool SDNARead::mapFile(SystemStringView path) {
+#if _WIN32
+  HANDLE file = CreateFileW(SystemString(path).c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING,
+                            FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+  if (file == INVALID_HANDLE_VALUE)
+    return false;
+  LARGE_INTEGER size;
+  if (!GetFileSizeEx(file, &size) || !size.QuadPart) {
+    CloseHandle(file);
+    return false;
+  }
+  HANDLE mapping = CreateFileMappingW(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+  CloseHandle(file);
+  if (!mapping)
+    return false;
+  m_map = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+  CloseHandle(mapping);
+  if (!m_map)
+    return false;
+  m_mapSize = size_t(size.QuadPart);
+#else
+  const int fd = open(SystemString(path).c_str(), O_RDONLY);
+  if (fd < 0)
+    return false;
+  struct stat st;
+  if (fstat(fd, &st) || !st.st_size) {
+    close(fd);
+    return false;
+  }
+  void* map = mmap(nullptr, size_t(st.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+  close(fd);
+  if (map == MAP_FAILED)
+    return false;
+  m_map = map;
+  m_mapSize = size_t(st.st_size);
+#endif
+  return true;
+}
+
+void SDNARead::unmapFile() {
+  if (!m_map)
     return;
+#if _WIN32
+  UnmapViewOfFile(m_map);
+#else
+  munmap(m_map, m_mapSize);
+#endif
+  m_map = nullptr;
+  m_mapSize = 0;
+}
 
-  atUint64 length = r.length();
-  char magicBuf[7];
-  r.readUBytesToBuf(magicBuf, 7);
-  r.seek(0, athena::SeekOrigin::Begin);
-  if (strncmp(magicBuf, "BLENDER", 7)) {
-    /* Try gzip decompression */
-    std::unique_ptr<uint8_t[]> compBuf(new uint8_t[4096]);
-    m_data.resize((length * 2 + 4095) & ~4095);
-    z_stream zstrm = {};
-    inflateInit2(&zstrm, 16 + MAX_WBITS);
-    zstrm.next_out = (Bytef*)m_data.data();
-    zstrm.avail_out = m_data.size();
-    zstrm.total_out = 0;
-
-    atUint64 rs;
-    while ((rs = r.readUBytesToBuf(compBuf.get(), 4096))) {
-      int inflateRet;
-      zstrm.next_in = compBuf.get();
-      zstrm.avail_in = rs;
-      while (zstrm.avail_in) {
-        if (!zstrm.avail_out) {
-          zstrm.avail_out = m_data.size();
-          m_data.resize(zstrm.avail_out * 2);
-          zstrm.next_out = (Bytef*)m_data.data() + zstrm.avail_out;
-        }
-        inflateRet = inflate(&zstrm, Z_NO_FLUSH);
-        if (inflateRet == Z_STREAM_END)
-          break;
-        if (inflateRet != Z_OK) {
-          inflateEnd(&zstrm);
-          m_data = std::vector<uint8_t>();
-          return;
+bool SDNARead::inflateGzip() {
+  const auto* comp = static_cast<const uint8_t*>(m_map);
+  if (m_mapSize < 18 || comp[0] != 0x1f || comp[1] != 0x8b)
+    return false;
+  /* ISIZE trailer holds the uncompressed length modulo 2^32; it is only trusted up to deflate's
+   * 1032:1 ratio limit and the buffer grows past it if it wrapped */
+  uint32_t isize;
+  std::memcpy(&isize, comp + m_mapSize - 4, 4);
+  size_t capacity = std::clamp(size_t(SLittle(isize)), size_t(4096), m_mapSize * 1032);
+  m_inflated.reset(new uint8_t[capacity]);
+
+  z_stream zstrm = {};
+  if (inflateInit2(&zstrm, 16 + MAX_WBITS) != Z_OK)
+    return false;
+
+  /* zlib counts in uInt, so input and output are handed over in chunks that fit */
+  constexpr size_t MaxChunk = std::numeric_limits<uInt>::max();
+  size_t inEnd = 0;
+  size_t outEnd = 0;
+  int inflateRet;
+  do {
+    if (!zstrm.avail_in && inEnd < m_mapSize) {
+      zstrm.next_in = const_cast<Bytef*>(comp + inEnd);
+      zstrm.avail_in = uInt(std::min(m_mapSize - inEnd, MaxChunk));
+      inEnd += zstrm.avail_in;
+    }
+    if (!zstrm.avail_out) {
+      if (outEnd == capacity) {
+        std::unique_ptr<uint8_t[]> grown(new uint8_t[capacity * 2]);
+        std::memcpy(grown.get(), m_inflated.get(), capacity);
+        m_inflated = std::move(grown);
+        capacity *= 2;
+      }
+      zstrm.next_out = m_inflated.get() + outEnd;
+      zstrm.avail_out = uInt(std::min(capacity - outEnd, MaxChunk));
+      outEnd += zstrm.avail_out;
+    }
+    inflateRet = inflate(&zstrm, Z_NO_FLUSH);
+    /* No progress possible with output room and no input left: truncated stream */
+    if ((inflateRet != Z_OK && inflateRet != Z_BUF_ERROR && inflateRet != Z_STREAM_END) ||
+        (inflateRet == Z_BUF_ERROR && zstrm.avail_out && inEnd == m_mapSize)) {
+      inflateEnd(&zstrm);
+      return false;
+    }
+  } while (inflateRet != Z_STREAM_END);
+
+  m_data = m_inflated.get();
+  m_size = outEnd - zstrm.avail_out;
+  inflateEnd(&zstrm);
+  return true;
+}
+
+#if HECL_HAS_ZSTD
+bool SDNARead::indexSeekable(const BlockFilter& keep) {
+  /* Seekable format: a trailing skippable frame listing every frame's compressed and decompressed size.
+   * Frames are decompressed one at a time as block headers and kept bodies are read out of them, so
+   * frames lying wholly inside skipped bodies are never decoded and only kept bodies stay resident. */
+  constexpr uint32_t SkippableMagic = 0x184D2A5E;
+  constexpr uint32_t SeekableMagic = 0x8F92EAB1;
+  const auto* comp = static_cast<const uint8_t*>(m_map);
+  if (m_mapSize < 17)
+    return false;
+  const auto readU32 = [comp](size_t off) {
+    uint32_t val;
+    std::memcpy(&val, comp + off, 4);
+    return SLittle(val);
+  };
+  if (readU32(m_mapSize - 4) != SeekableMagic)
+    return false;
+  const uint32_t numFrames = readU32(m_mapSize - 9);
+  const uint8_t descriptor = comp[m_mapSize - 5];
+  const size_t entrySize = (descriptor & 0x80) ? 12 : 8;
+  const size_t tableSize = size_t(numFrames) * entrySize + 9;
+  if (!numFrames || tableSize + 8 > m_mapSize)
+    return false;
+  const size_t tableStart = m_mapSize - tableSize;
+  if (readU32(tableStart - 8) != SkippableMagic || readU32(tableStart - 4) != tableSize)
+    return false;
+
+  struct Frame {
+    size_t compOffset;
+    size_t compSize;
+    size_t offset;
+    size_t size;
+  };
+  std::vector<Frame> frames(numFrames);
+  size_t compOffset = 0;
+  size_t size = 0;
+  for (uint32_t i = 0; i < numFrames; ++i) {
+    Frame& frame = frames[i];
+    frame.compOffset = compOffset;
+    frame.compSize = readU32(tableStart + i * entrySize);
+    frame.offset = size;
+    frame.size = readU32(tableStart + i * entrySize + 4);
+    compOffset += frame.compSize;
+    size += frame.size;
+  }
+  if (compOffset > tableStart - 8)
+    return false;
+
+  /* Copies decompressed bytes out of the frames covering a range, keeping the last frame decoded */
+  std::unique_ptr<uint8_t[]> frameBuf;
+  size_t frameBufSize = 0;
+  size_t decodedFrame = SIZE_MAX;
+  const auto read = [&](size_t offset, size_t len, uint8_t* dst) {
+    auto it = std::upper_bound(frames.cbegin(), frames.cend(), offset,
+                               [](size_t off, const Frame& frame) { return off < frame.offset; });
+    for (--it; len; ++it) {
+      if (it == frames.cend())
+        return false;
+      const size_t frameIdx = size_t(it - frames.cbegin());
+      if (decodedFrame != frameIdx) {
+        if (it->size > frameBufSize) {
+          frameBuf.reset(new uint8_t[it->size]);
+          frameBufSize = it->size;
         }
+        const size_t ret = ZSTD_decompress(frameBuf.get(), it->size, comp + it->compOffset, it->compSize);
+        if (ZSTD_isError(ret) || ret != it->size)
+          return false;
+        decodedFrame = frameIdx;
       }
-      if (inflateRet == Z_STREAM_END)
+      const size_t frameOffset = offset - it->offset;
+      const size_t copyLen = std::min(len, it->size - frameOffset);
+      std::memcpy(dst, frameBuf.get() + frameOffset, copyLen);
+      dst += copyLen;
+      offset += copyLen;
+      len -= copyLen;
+    }
+    return true;
+  };
+
+  uint8_t header[24];
+  if (size < 12 || !read(0, 12, header) || std::memcmp(header, "BLENDER", 7))
+    return false;
+  for (size_t pos = 12; pos + 24 <= size && read(pos, 24, header);) {
+    BlockEntry block;
+    athena::io::MemoryReader r(header, 24);
+    block.header.read(r);
+    const size_t bodyPos = pos + 24;
+    if (block.header.type == FOURCC('ENDB') || bodyPos + block.header.size > size)
+      break;
+    block.offset = NotResident;
+    if (block.header.type == FOURCC('DNA1') || !keep || keep(block.header)) {
+      const size_t residentPos = m_resident.size();
+      m_resident.resize(residentPos + block.header.size);
+      if (!read(bodyPos, block.header.size, m_resident.data() + residentPos)) {
+        m_resident.resize(residentPos);
         break;
+      }
+      block.offset = residentPos;
+    }
+    m_blocks.push_back(block);
+    pos = bodyPos + block.header.size;
+  }
+
+  m_data = m_resident.data();
+  m_size = size;
+  return true;
+}
+
+bool SDNARead::decompressZstd() {
+  /* Without a seek table the whole stream is decompressed up front */
+  const unsigned long long contentSize = ZSTD_findDecompressedSize(m_map, m_mapSize);
+  if (contentSize == ZSTD_CONTENTSIZE_ERROR)
+    return false;
+  size_t capacity = contentSize == ZSTD_CONTENTSIZE_UNKNOWN ? m_mapSize * 4 : size_t(contentSize);
+  capacity = std::max(capacity, size_t(4096));
+  m_inflated.reset(new uint8_t[capacity]);
+
+  ZSTD_DStream* dstrm = ZSTD_createDStream();
+  ZSTD_inBuffer in = {m_map, m_mapSize, 0};
+  ZSTD_outBuffer out = {m_inflated.get(), capacity, 0};
+  for (;;) {
+    /* A zero hint means the current frame is fully decoded and flushed */
+    const size_t hint = ZSTD_decompressStream(dstrm, &out, &in);
+    if (ZSTD_isError(hint)) {
+      ZSTD_freeDStream(dstrm);
+      return false;
+    }
+    if (!hint && in.pos == in.size)
+      break;
+    if (out.pos == out.size) {
+      std::unique_ptr<uint8_t[]> grown(new uint8_t[capacity * 2]);
+      std::memcpy(grown.get(), m_inflated.get(), capacity);
+      m_inflated = std::move(grown);
+      capacity *= 2;
+      out.dst = m_inflated.get();
+      out.size = capacity;
+    } else if (in.pos == in.size) {
+      /* Input exhausted with output room left mid-frame: truncated stream */
+      ZSTD_freeDStream(dstrm);
+      return false;
     }
+  }
+  ZSTD_freeDStream(dstrm);
 
-    inflateEnd(&zstrm);
+  m_data = m_inflated.get();
+  m_size = out.pos;
+  return true;
+}
+#endif
 
-    if (strncmp((char*)m_data.data(), "BLENDER", 7)) {
-      m_data = std::vector<uint8_t>();
+void SDNARead::indexBlocks() {
+  /* Record header positions only; bodies are not copied */
+  size_t pos = 12;
+  while (pos + 24 <= m_size) {
+    athena::io::MemoryReader r(m_data + pos, 24);
+    BlockEntry& block = m_blocks.emplace_back();
+    block.header.read(r);
+    block.offset = pos + 24;
+    if (block.header.type == FOURCC('ENDB') || block.offset + block.header.size > m_size) {
+      m_blocks.pop_back();
+      break;
+    }
+    pos = block.offset + block.header.size;
+  }
+}
+
+SDNARead::SDNARead(SystemStringView path, const BlockFilter& keep) {
+  if (!mapFile(path))
+    return;
+
+  bool indexed = false;
+#if HECL_HAS_ZSTD
+  if (m_mapSize >= 4 && !std::memcmp(m_map, ZstdMagic, 4)) {
+    /* Seekable blends are indexed frame by frame, others decoded as one stream;
+     * the mapping is not needed afterwards */
+    indexed = indexSeekable(keep);
+    if (!indexed) {
+      m_blocks.clear();
+      m_resident.clear();
+    }
+    const bool decompressed = indexed || decompressZstd();
+    unmapFile();
+    if (!decompressed || (!indexed && (m_size < 12 || std::memcmp(m_data, "BLENDER", 7)))) {
+      m_inflated.reset();
+      m_data = nullptr;
+      m_size = 0;
+      return;
+    }
+  } else
+#endif
+  if (m_mapSize < 12 || std::memcmp(m_map, "BLENDER", 7)) {
+    /* Try gzip decompression; the compressed mapping is not needed afterwards */
+    const bool inflated = inflateGzip();
+    unmapFile();
+    if (!inflated || m_size < 12 || std::memcmp(m_data, "BLENDER", 7)) {
+      m_inflated.reset();
+      m_data = nullptr;
+      m_size = 0;
       return;
     }
   } else {
-    m_data.resize(length);
-    r.readUBytesToBuf(m_data.data(), length);
+    m_data = static_cast<const uint8_t*>(m_map);
+    m_size = m_mapSize;
   }
 
-  enumerate([this](const FileBlock& block, athena::io::MemoryReader& r) {
-    if (block.type == FOURCC('DNA1')) {
+  if (!indexed)
+    indexBlocks();
+  for (const BlockEntry& block : m_blocks) {
+    if (block.header.type == FOURCC('DNA1')) {
+      athena::io::MemoryReader r(blockData(block), block.header.size);
       m_sdnaBlock.read(r);
-      for (SDNABlock::SDNAStruct& s : m_sdnaBlock.strcs)
-        s.computeOffsets(m_sdnaBlock);
-      return false;
+      m_sdnaBlock.buildIndexes();
+      break;
     }
-    return true;
-  });
+  }
 }
 
-BlendType GetBlendType(SystemStringView path) {
-  SDNARead r(path);
-  if (!r)
-    return BlendType::None;
+SDNARead::~SDNARead() { unmapFile(); }
 
-  atUint32 idPropIdx;
-  const auto* idPropStruct = r.sdnaBlock().lookupStruct("IDProperty", idPropIdx);
-  if (!idPropStruct)
-    return BlendType::None;
-  const auto* typeField = idPropStruct->lookupField(r.sdnaBlock(), "type");
-  if (!typeField)
+namespace {
+/* Only the scene's own IDProperty blocks are kept; anything larger is not a single IDProperty */
+constexpr atUint32 MaxIDPropertySize = 512;
+
+struct SceneProperty {
+  atUint32 sdnaIdx;
+  std::vector<uint8_t> data;
+};
+
+/* Selects the single-IDProperty DATA blocks written directly after the first scene */
+class ScenePropertyFilter {
+  bool m_sceneSeen = false;
+  bool m_inScene = false;
+
+public:
+  bool operator()(const FileBlock& block) {
+    if (block.type == FOURCC('SC\0\0') && !m_sceneSeen) {
+      m_sceneSeen = m_inScene = true;
+      return false;
+    }
+    if (m_inScene && block.type == FOURCC('DATA'))
+      return block.count == 1 && block.size <= MaxIDPropertySize;
+    m_inScene = false;
+    return false;
+  }
+};
+
+BlendType ClassifySceneProperties(const SDNABlock& sdnaBlock, const std::vector<SceneProperty>& props) {
+  const auto typeField = sdnaBlock.resolveField("IDProperty", "type");
+  const auto nameField = sdnaBlock.resolveField("IDProperty", "name");
+  const auto dataField = sdnaBlock.resolveField("IDProperty", "data");
+  const auto valField = sdnaBlock.resolveField("IDPropertyData", "val");
+  if (!typeField || !nameField || !dataField || !valField)
     return BlendType::None;
-  atUint32 typeOffset = typeField->offset;
-  const auto* nameField = idPropStruct->lookupField(r.sdnaBlock(), "name");
-  if (!nameField)
+  const atUint32 idPropIdx = typeField.sdnaIdx;
+  const atUint32 typeOffset = typeField.offset;
+  const atUint32 nameOffset = nameField.offset;
+  const atUint32 valOffset = dataField.offset + valField.offset;
+
+  for (const SceneProperty& prop : props) {
+    if (prop.sdnaIdx != idPropIdx || valOffset + 4 > prop.data.size())
+      continue;
+    athena::io::MemoryReader r(prop.data.data(), prop.data.size());
+    r.seek(typeOffset, athena::SeekOrigin::Begin);
+    if (r.readUByte() != 1)
+      continue;
+
+    r.seek(nameOffset, athena::SeekOrigin::Begin);
+    if (r.readString() != "hecl_type")
+      continue;
+
+    r.seek(valOffset, athena::SeekOrigin::Begin);
+    return BlendType(r.readUint32Little());
+  }
+
+  return BlendType::None;
+}
+
+/* Walks block headers from just past the file header, seeking over bodies.
+ * Keeps the IDProperty-sized DATA blocks following the first scene and the DNA1 schema,
+ * which blender writes last. */
+template <typename ReadExact, typename Skip>
+BlendType StreamBlendType(ReadExact readExact, Skip skip) {
+  std::vector<SceneProperty> props;
+  std::vector<uint8_t> dnaData;
+  ScenePropertyFilter filter;
+  uint8_t blockHeader[24];
+  while (readExact(blockHeader, 24)) {
+    FileBlock block;
+    athena::io::MemoryReader hr(blockHeader, 24);
+    block.read(hr);
+    if (block.type == FOURCC('ENDB'))
+      break;
+
+    if (block.type == FOURCC('DNA1')) {
+      dnaData.resize(block.size);
+      if (!readExact(dnaData.data(), block.size))
+        dnaData.clear();
+      break;
+    }
+
+    if (filter(block)) {
+      SceneProperty& prop = props.emplace_back();
+      prop.sdnaIdx = block.sdnaIdx;
+      prop.data.resize(block.size);
+      if (!readExact(prop.data.data(), block.size))
+        break;
+      continue;
+    }
+
+    if (!skip(block.size))
+      break;
+  }
+
+  if (dnaData.empty() || props.empty())
     return BlendType::None;
-  atUint32 nameOffset = nameField->offset;
-  const auto* dataField = idPropStruct->lookupField(r.sdnaBlock(), "data");
-  if (!dataField)
+
+  SDNABlock sdnaBlock;
+  athena::io::MemoryReader r(dnaData.data(), dnaData.size());
+  sdnaBlock.read(r);
+  sdnaBlock.buildIndexes();
+  return ClassifySceneProperties(sdnaBlock, props);
+}
+
+/* gzip transparently inflates and discards skipped bodies */
+BlendType GetGzipBlendType(SystemStringView path) {
+#if _WIN32
+  gzFile file = gzopen_w(SystemString(path).c_str(), "rb");
+#else
+  gzFile file = gzopen(SystemString(path).c_str(), "rb");
+#endif
+  if (!file)
     return BlendType::None;
-  atUint32 dataOffset = dataField->offset;
+  const auto readExact = [file](void* buf, atUint32 size) { return gzread(file, buf, size) == int(size); };
+  const auto skip = [file](atUint32 size) { return !size || gzseek(file, size, SEEK_CUR) != -1; };
+  char header[12];
+  const BlendType type =
+      readExact(header, 12) && !std::strncmp(header, "BLENDER", 7) ? StreamBlendType(readExact, skip) : BlendType::None;
+  gzclose(file);
+  return type;
+}
 
-  atUint32 idPropDataIdx;
-  const auto* idPropDataStruct = r.sdnaBlock().lookupStruct("IDPropertyData", idPropDataIdx);
-  if (!idPropDataStruct)
+#if HECL_HAS_ZSTD
+/* Zstd blends go through SDNARead; seekable ones only decode the frames holding DNA1 and scene properties */
+BlendType GetZstdBlendType(SystemStringView path) {
+  ScenePropertyFilter keep;
+  SDNARead r(path, [&keep](const FileBlock& block) { return keep(block); });
+  if (!r)
     return BlendType::None;
-  const auto* valField = idPropDataStruct->lookupField(r.sdnaBlock(), "val");
-  if (!valField)
+  std::vector<SceneProperty> props;
+  ScenePropertyFilter filter;
+  for (const auto& block : r.blocks()) {
+    if (!filter(block.header))
+      continue;
+    const uint8_t* data = r.blockData(block);
+    if (!data)
+      continue;
+    props.push_back({block.header.sdnaIdx, std::vector<uint8_t>(data, data + block.header.size)});
+  }
+  return ClassifySceneProperties(r.sdnaBlock(), props);
+}
+#endif
+} // namespace
+
+BlendType GetBlendType(SystemStringView path) {
+  /* Uncompressed blends are read directly; the magic picks a decompressor otherwise */
+  auto fp = FopenUnique(SystemString(path).c_str(), _SYS_STR("rb"));
+  if (fp == nullptr)
     return BlendType::None;
-  atUint32 valOffset = dataOffset + valField->offset;
-
-  BlendType ret = BlendType::None;
-  r.enumerate(
-      [idPropIdx, typeOffset, nameOffset, valOffset, &ret](const FileBlock& block, athena::io::MemoryReader& r) {
-        if (block.type == FOURCC('DATA') && block.sdnaIdx == idPropIdx) {
-          r.seek(typeOffset, athena::SeekOrigin::Begin);
-          if (r.readUByte() != 1)
-            return true;
-
-          r.seek(nameOffset, athena::SeekOrigin::Begin);
-          if (r.readString() != "hecl_type")
-            return true;
-
-          r.seek(valOffset, athena::SeekOrigin::Begin);
-          ret = BlendType(r.readUint32Little());
-          return false;
-        }
-        return true;
-      });
+  char header[12];
+  const size_t headerSize = std::fread(header, 1, 12, fp.get());
+
+  if (headerSize == 12 && !std::strncmp(header, "BLENDER", 7)) {
+    FILE* file = fp.get();
+    return StreamBlendType([file](void* buf, atUint32 size) { return std::fread(buf, 1, size, file) == size; },
+                           [file](atUint32 size) { return !size || FSeek(file, size, SEEK_CUR) == 0; });
+  }
+  fp.reset();
+
+  if (headerSize >= 2 && uint8_t(header[0]) == 0x1f && uint8_t(header[1]) == 0x8b)
+    return GetGzipBlendType(path);
+#if HECL_HAS_ZSTD
+  if (headerSize >= 4 && !std::memcmp(header, SDNARead::ZstdMagic, 4))
+    return GetZstdBlendType(path);
+#endif
+  return BlendType::None;
+}
+
+namespace {
+std::string ReadCString(const uint8_t* data, size_t size, atUint32 offset, size_t maxLen) {
+  if (offset >= size)
+    return {};
+  const auto* str = reinterpret_cast<const char*>(data + offset);
+  return std::string(str, strnlen(str, std::min(maxLen, size - offset)));
+}
+
+uint64_t ReadPointer(const uint8_t* data, size_t size, atUint32 offset) {
+  uint64_t ptr = 0;
+  if (offset + 8 <= size)
+    std::memcpy(&ptr, data + offset, 8);
+  return ptr;
+}
+
+/* Image sources backed by files on disk (file, sequence, movie, tiled) */
+constexpr bool IsFileImageSource(int16_t source) { return source == 1 || source == 2 || source == 3 || source == 6; }
+} // namespace
+
+std::vector<BlendDependency> GetBlendDependencies(SystemStringView path) {
+  std::vector<BlendDependency> ret;
+  SDNARead r(path, [](const FileBlock& block) {
+    return block.type == FOURCC('LI\0\0') || block.type == FOURCC('IM\0\0');
+  });
+  if (!r)
+    return ret;
+
+  const SDNABlock& dna = r.sdnaBlock();
+  const auto idName = dna.resolveField("ID", "name");
+  const auto idLib = dna.resolveField("ID", "*lib");
+  const auto libId = dna.resolveField("Library", "id");
+  /* Older blenders keep the user path in 'name' and a runtime absolute path in 'filepath' */
+  const auto libPath = dna.resolveField("Library", dna.resolveField("Library", "filepath_abs") ? "filepath" : "name");
+  const auto imaId = dna.resolveField("Image", "id");
+  const auto imaPath = dna.resolveField("Image", dna.resolveField("Image", "filepath") ? "filepath" : "name");
+  const auto imaSource = dna.resolveField("Image", "source");
+  const auto imaPackedList = dna.resolveField("Image", "packedfiles");
+  const auto imaPacked = dna.resolveField("Image", "*packedfile");
+  if (!idName)
+    return ret;
+
+  for (const auto& block : r.blocks()) {
+    const bool isLibrary = block.header.type == FOURCC('LI\0\0') && libId && libPath &&
+                           block.header.sdnaIdx == libId.sdnaIdx;
+    const bool isImage = block.header.type == FOURCC('IM\0\0') && imaId && imaPath &&
+                         block.header.sdnaIdx == imaId.sdnaIdx;
+    if (!isLibrary && !isImage)
+      continue;
+    const uint8_t* data = r.blockData(block);
+    if (!data)
+      continue;
+    const size_t size = block.header.size;
+
+    if (isImage) {
+      /* Linked images are covered by their library; packed images carry their own data */
+      if (idLib && ReadPointer(data, size, imaId.offset + idLib.offset))
+        continue;
+      if (imaPackedList && ReadPointer(data, size, imaPackedList.offset))
+        continue;
+      if (imaPacked && ReadPointer(data, size, imaPacked.offset))
+        continue;
+      if (imaSource && imaSource.offset + 2 <= size) {
+        int16_t source;
+        std::memcpy(&source, data + imaSource.offset, 2);
+        if (!IsFileImageSource(source))
+          continue;
+      }
+    }
+
+    const auto& idField = isLibrary ? libId : imaId;
+    std::string name = ReadCString(data, size, idField.offset + idName.offset, 66);
+    std::string filePath = ReadCString(data, size, isLibrary ? libPath.offset : imaPath.offset, 1024);
+    if (filePath.empty())
+      continue;
+    ret.push_back({isLibrary ? BlendDependency::Kind::Library : BlendDependency::Kind::Image,
+                   name.size() > 2 ? name.substr(2) : std::string(), std::move(filePath)});
+  }
+
+  return ret;
+}
+
+SystemString ResolveBlendDependency(SystemStringView blendPath, const BlendDependency& dep) {
+  SystemString depPath;
+  if (!dep.path.compare(0, 2, "//")) {
+    const size_t dirEnd = blendPath.find_last_of(_SYS_STR("/\\"));
+    depPath = SystemString(blendPath.substr(0, dirEnd == SystemStringView::npos ? 0 : dirEnd)) + _SYS_STR('/') +
+              SystemString(SystemStringConv(std::string_view(dep.path).substr(2)).sys_str());
+  } else {
+    depPath = SystemStringConv(dep.path).sys_str();
+  }
+  if (!IsAbsolute(depPath))
+    return {};
+
+  /* Collapse '.' and '..' here so callers can compare against the project root by prefix */
+  for (SystemChar& ch : depPath)
+    if (ch == _SYS_STR('\\'))
+      ch = _SYS_STR('/');
+  const size_t rootEnd = depPath.find(_SYS_STR('/')) + 1;
+  std::vector<SystemStringView> comps;
+  for (size_t pos = rootEnd, end; pos <= depPath.size(); pos = end + 1) {
+    end = depPath.find(_SYS_STR('/'), pos);
+    if (end == SystemString::npos)
+      end = depPath.size();
+    const SystemStringView comp(depPath.data() + pos, end - pos);
+    if (comp.empty() || comp == _SYS_STR("."))
+      continue;
+    if (comp == _SYS_STR("..")) {
+      if (comps.empty())
+        return {};
+      comps.pop_back();
+      continue;
+    }
+    comps.push_back(comp);
+  }
+  if (comps.empty())
+    return {};
+  SystemString ret = depPath.substr(0, rootEnd);
+  for (SystemStringView comp : comps) {
+    if (ret.size() > rootEnd)
+      ret += _SYS_STR('/');
+    ret += comp;
+  }
+  return ret;
+}
 
+std::vector<ProjectPath> GetBlendDependencies(const ProjectPath& path) {
+  std::vector<ProjectPath> ret;
+  const SystemString projRoot(path.getProject().getProjectRootPath().getAbsolutePath());
+  for (const BlendDependency& dep : GetBlendDependencies(path.getAbsolutePath())) {
+    const SystemString depPath = ResolveBlendDependency(path.getAbsolutePath(), dep);
+    if (depPath.compare(0, projRoot.size(), projRoot) || depPath.size() <= projRoot.size() + 1 ||
+        depPath[projRoot.size()] != _SYS_STR('/'))
+      continue;
+    ret.emplace_back(path.getProject(), SystemStringView(depPath).substr(projRoot.size() + 1));
+  }
   return ret;
 }
 
+bool BlendTypeCache::StatIdentity(const ProjectPath& path, Identity& id) {
+#if _WIN32
+  /* _wstat reports no inode and whole-second mtimes; the handle gives the file index and 100ns write time */
+  HANDLE file = CreateFileW(path.getAbsolutePath().data(), FILE_READ_ATTRIBUTES,
+                            FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE, nullptr, OPEN_EXISTING,
+                            FILE_FLAG_BACKUP_SEMANTICS, nullptr);
+  if (file == INVALID_HANDLE_VALUE)
+    return false;
+  BY_HANDLE_FILE_INFORMATION info;
+  const bool gotInfo = GetFileInformationByHandle(file, &info);
+  CloseHandle(file);
+  if (!gotInfo)
+    return false;
+  id.inode = uint64_t(info.nFileIndexHigh) << 32 | info.nFileIndexLow;
+  id.size = uint64_t(info.nFileSizeHigh) << 32 | info.nFileSizeLow;
+  id.mtime = int64_t(uint64_t(info.ftLastWriteTime.dwHighDateTime) << 32 | info.ftLastWriteTime.dwLowDateTime);
+  return true;
+#else
+  Sstat st;
+  if (Stat(path.getAbsolutePath().data(), &st))
+    return false;
+  id.inode = uint64_t(st.st_ino);
+  id.size = uint64_t(st.st_size);
+  id.mtime = int64_t(st.st_mtime) * 1000000000;
+#if __linux__
+  id.mtime += st.st_mtim.tv_nsec;
+#elif __APPLE__
+  id.mtime += st.st_mtimespec.tv_nsec;
+#endif
+  return true;
+#endif
+}
+
+/* One record per line; later lines supersede earlier ones for the same path:
+ * <inode> <size> <mtime> <hash> <type> <rigged: 0, 1 or 2 for unknown> <relative path> */
+void BlendTypeCache::load() {
+  m_loaded = true;
+  auto fp = FopenUnique(m_filePath.c_str(), _SYS_STR("rb"));
+  if (fp == nullptr)
+    return;
+  char line[2048];
+  while (std::fgets(line, sizeof(line), fp.get())) {
+    char* cur = line;
+    Record rec;
+    rec.id.inode = std::strtoull(cur, &cur, 16);
+    rec.id.size = std::strtoull(cur, &cur, 16);
+    rec.id.mtime = std::strtoll(cur, &cur, 16);
+    rec.entry.hash = std::strtoull(cur, &cur, 16);
+    const unsigned long type = std::strtoul(cur, &cur, 10);
+    const unsigned long rigged = std::strtoul(cur, &cur, 10);
+    if (*cur != ' ' || type > unsigned(BlendType::PathMesh) || rigged > 2)
+      continue;
+    std::string relPath(cur + 1);
+    if (relPath.empty() || relPath.back() != '\n')
+      continue;
+    relPath.pop_back();
+    rec.entry.type = BlendType(type);
+    if (rigged != 2)
+      rec.entry.rigged = rigged != 0;
+    m_records[std::move(relPath)] = rec;
+    ++m_logRecords;
+  }
+}
+
+void BlendTypeCache::compact() {
+  /* Rewritten aside and renamed so concurrent readers never see a partial file */
+  const SystemString tmpPath = m_filePath + TempFileSuffix();
+  {
+    auto fp = FopenUnique(tmpPath.c_str(), _SYS_STR("wb"));
+    if (fp == nullptr)
+      return;
+    for (const auto& [relPath, rec] : m_records) {
+      fmt::print(fp.get(), FMT_STRING("{:x} {:x} {:x} {:x} {} {} {}\n"), rec.id.inode, rec.id.size, rec.id.mtime,
+                 rec.entry.hash, int(rec.entry.type), rec.entry.rigged ? int(*rec.entry.rigged) : 2, relPath);
+    }
+  }
+  if (Rename(tmpPath.c_str(), m_filePath.c_str()))
+    Unlink(tmpPath.c_str());
+  else
+    m_logRecords = m_records.size();
+}
+
+BlendTypeCache& BlendTypeCache::ForProject(const ProjectPath& path) {
+  static std::mutex RegistryLock;
+  static std::unordered_map<SystemString, std::unique_ptr<BlendTypeCache>> Registry;
+  const SystemString filePath(
+      ProjectPath(path.getProject().getProjectWorkingPath(), _SYS_STR(".hecl/blendtypes")).getAbsolutePath());
+  std::lock_guard lk(RegistryLock);
+  auto& cache = Registry[filePath];
+  if (!cache)
+    cache = std::make_unique<BlendTypeCache>(filePath);
+  return *cache;
+}
+
+std::optional<BlendTypeCache::Entry> BlendTypeCache::lookup(const ProjectPath& path) {
+  std::lock_guard lk(m_lock);
+  if (!m_loaded)
+    load();
+  const auto search = m_records.find(std::string(path.getRelativePathUTF8()));
+  if (search == m_records.cend())
+    return std::nullopt;
+  Identity id;
+  if (!StatIdentity(path, id) || !(id == search->second.id))
+    return std::nullopt;
+  return search->second.entry;
+}
+
+void BlendTypeCache::store(const ProjectPath& path, const Entry& entry) {
+  Record rec;
+  if (!StatIdentity(path, rec.id))
+    return;
+  rec.entry = entry;
+
+  std::lock_guard lk(m_lock);
+  if (!m_loaded)
+    load();
+  std::string relPath(path.getRelativePathUTF8());
+  auto& existing = m_records[relPath];
+  if (existing.id == rec.id && existing.entry.type == entry.type) {
+    /* Keep details learned by an earlier, more thorough classification */
+    if (!rec.entry.rigged)
+      rec.entry.rigged = existing.entry.rigged;
+    if (!rec.entry.hash)
+      rec.entry.hash = existing.entry.hash;
+    if (rec.entry.rigged == existing.entry.rigged && rec.entry.hash == existing.entry.hash)
+      return;
+  }
+  existing = rec;
+
+  if (m_logRecords > m_records.size() * 2 + 64) {
+    compact();
+    return;
+  }
+  MakeDir(ProjectPath(path.getProject().getProjectWorkingPath(), _SYS_STR(".hecl")).getAbsolutePath().data());
+  auto fp = FopenUnique(m_filePath.c_str(), _SYS_STR("ab"));
+  if (fp == nullptr)
+    return;
+  /* A single append per record keeps concurrent writers from interleaving lines */
+  const std::string line = fmt::format(FMT_STRING("{:x} {:x} {:x} {:x} {} {} {}\n"), rec.id.inode, rec.id.size,
+                                       rec.id.mtime, rec.entry.hash, int(rec.entry.type),
+                                       rec.entry.rigged ? int(*rec.entry.rigged) : 2, relPath);
+  std::fwrite(line.data(), 1, line.size(), fp.get());
+  ++m_logRecords;
+}
+
+BlendType GetBlendType(const ProjectPath& path) {
+  BlendTypeCache& cache = BlendTypeCache::ForProject(path);
+  if (auto entry = cache.lookup(path))
+    return entry->type;
+  const BlendType type = GetBlendType(path.getAbsolutePath());
+  /* Only meshes carry a rig state, which needs blender to determine */
+  if (type != BlendType::None)
+    cache.store(path, {type, type == BlendType::Mesh ? std::nullopt : std::optional<bool>(false), 0});
+  return type;
+}
+
 } // namespace hecl::blender
@@ -77,7 +77,19 @@ void ClientProcess::BufferTransaction::run(blender::Token& btok) {
 void ClientProcess::CookTransaction::run(blender::Token& btok) {
   m_dataSpec->setThreadProject();
   m_returnResult = m_parent.syncCook(m_path, m_dataSpec, btok, m_force, m_fast);
+  if (btok.recoverDiedConnection()) {
+    /* Blender crashed mid-cook; retry once on a fresh instance */
+    m_returnResult = m_parent.syncCook(m_path, m_dataSpec, btok, true, m_fast);
+    if (btok.recoverDiedConnection()) {
+      m_failed = true;
+      m_returnResult = false;
+      CP_Log.report(logvisor::Error, FMT_STRING(_SYS_STR("giving up on '{}' after blender crashed twice")),
+                    m_path.getRelativePath());
+    }
+  }
   std::unique_lock lk{m_parent.m_mutex};
+  if (m_failed)
+    ++m_parent.m_failedCooks;
   ++m_parent.m_completedCooks;
   m_parent.m_progPrinter->setMainFactor(m_parent.m_completedCooks / float(m_parent.m_addedCooks));
   m_complete = true;
@@ -85,10 +97,13 @@ void ClientProcess::CookTransaction::run(blender::Token& btok) {
 
 void ClientProcess::LambdaTransaction::run(blender::Token& btok) {
   m_func(btok);
+  btok.recoverDiedConnection();
   m_complete = true;
 }
 
 ClientProcess::Worker::Worker(ClientProcess& proc, int idx) : m_proc(proc), m_idx(idx) {
+  m_blendTok.setRecoverable(true);
+  m_blendTok.setMeshThreads(proc.m_meshThreads);
   m_thr = std::thread(std::bind(&Worker::proc, this));
 }
 
@@ -110,6 +125,7 @@ void ClientProcess::Worker::proc() {
       m_proc.m_pendingQueue.pop_front();
       lk.unlock();
       trans->run(m_blendTok);
+      m_blendTok.recycleIfNeeded();
       lk.lock();
       m_proc.m_completedQueue.push_back(std::move(trans));
       --m_proc.m_inProgress;
@@ -117,7 +133,16 @@ void ClientProcess::Worker::proc() {
     m_proc.m_waitCv.notify_one();
     if (!m_proc.m_running)
       break;
-    m_proc.m_cv.wait(lk);
+    const auto idleTimeout = m_blendTok.getRecyclePolicy().idleTimeout;
+    if (idleTimeout.count() && m_blendTok.hasBlenderConnection()) {
+      /* Wake up periodically so an idle blender can be shut down */
+      m_proc.m_cv.wait_for(lk, idleTimeout);
+      lk.unlock();
+      m_blendTok.recycleIfNeeded();
+      lk.lock();
+    } else {
+      m_proc.m_cv.wait(lk);
+    }
   }
   lk.unlock();
   m_blendTok.shutdown();
@@ -129,6 +154,8 @@ ClientProcess::ClientProcess(const MultiProgressPrinter* progPrinter) : m_progPr
 #else
   constexpr int cpuCount = 1;
 #endif
+  /* Workers already run one per CPU; mesh compiles only get the CPUs left over when -j asks for fewer */
+  m_meshThreads = unsigned(std::max(1, int(std::thread::hardware_concurrency()) / cpuCount));
   m_workers.reserve(cpuCount);
   for (int i = 0; i < cpuCount; ++i) {
     std::unique_lock lk{m_mutex};
@@ -193,6 +220,11 @@ bool ClientProcess::syncCook(const hecl::ProjectPath& path, Database::IDataSpec*
             LogModule.report(logvisor::Info, FMT_STRING(_SYS_STR("Cooking {}|{}")), path.getRelativePath(), path.getAuxInfo());
         }
         spec->doCook(path, cooked, false, btok, [](const SystemChar*) {});
+        if (btok.blenderDied()) {
+          /* Don't leave a partial cook behind to satisfy the modtime check */
+          hecl::Unlink(cooked.getAbsolutePath().data());
+          return false;
+        }
         if (m_progPrinter) {
           hecl::SystemString str;
           if (path.getAuxInfo().empty())
@@ -218,6 +250,9 @@ void ClientProcess::waitUntilComplete() {
   std::unique_lock lk{m_mutex};
   while (isBusy())
     m_waitCv.wait(lk);
+  if (m_failedCooks)
+    CP_Log.report(logvisor::Error, FMT_STRING("{} of {} cooks failed after blender crashed"), m_failedCooks,
+                  m_addedCooks);
 }
 
 void ClientProcess::shutdown() {
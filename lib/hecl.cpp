@@ -1,6 +1,7 @@
 #include "hecl/hecl.hpp"
 
 #include <algorithm>
+#include <atomic>
 #include <cstdio>
 #include <cstdlib>
 #include <map>
@@ -707,6 +708,16 @@ const SystemChar* GetTmpDir() {
   return TMPDIR;
 }
 
+SystemString TempFileSuffix() {
+  static std::atomic<uint64_t> Counter{0};
+#ifdef _WIN32
+  const unsigned long pid = GetCurrentProcessId();
+#else
+  const long pid = getpid();
+#endif
+  return fmt::format(FMT_STRING(_SYS_STR(".{}.{}")), pid, Counter.fetch_add(1));
+}
+
 #if !WINDOWS_STORE
 int RunProcess(const SystemChar* path, const SystemChar* const args[]) {
 #ifdef _WIN32